@@ -8,6 +8,10 @@ CONFIG   -= app_bundle
 QMAKE_CXXFLAGS_RELEASE += -O3
 QMAKE_LFLAGS_RELEASE += -O3
 
+# Vectorized child selection for arithmetic heaps (see binary_heap.h)
+#DEFINES += BINARY_MAX_HEAP_SIMD
+#QMAKE_CXXFLAGS_RELEASE += -mavx2
+
 TEMPLATE = app
 
 SOURCES += \
@@ -16,6 +20,8 @@ SOURCES += \
     stdvalpqadaptor.cpp \
     libuvheapadaptor.cpp \
     myheapadaptor.cpp \
+    timerwheeladaptor.cpp \
+    radixheapadaptor.cpp \
     tst_priorityqueuebench.cpp
 HEADERS += timerdata.h \
     stdptrpqadaptor.h \
@@ -25,6 +31,21 @@ HEADERS += timerdata.h \
     qptrlistadaptor.h \
     myheapadaptor.h \
     libuvheapadaptor.h \
-    ../binary_heap.h
+    timerwheeladaptor.h \
+    radixheapadaptor.h \
+    ../binary_heap.h \
+    ../split_heap.h \
+    ../handle_heap.h \
+    ../concurrent_heap.h \
+    ../multi_queue.h \
+    ../radix_heap.h \
+    ../buffered_heap.h \
+    ../external_heap.h \
+    ../mapped_vector.h \
+    ../journaled_heap.h \
+    ../segmented_vector.h \
+    ../small_vector.h \
+    ../checksum.h \
+    ../test/lcg.h
 INCLUDEPATH += ..
 DEFINES += SRCDIR=\\\"$$PWD/\\\"
@@ -2,7 +2,8 @@
 
 #include <algorithm>
 
-int MyHeapAdaptor::registerTimer(int interval, int64_t current)
+template< class Heap >
+int MyHeapAdaptorT<Heap>::registerTimer(int interval, int64_t current)
 {
     QTimerInfo v;
     const int id = m_nextId++;
@@ -11,7 +12,8 @@ int MyHeapAdaptor::registerTimer(int interval, int64_t current)
     return id;
 }
 
-void MyHeapAdaptor::unregisterTimer(int timerId)
+template< class Heap >
+void MyHeapAdaptorT<Heap>::unregisterTimer(int timerId)
 {
     auto it = std::find_if(heap.cbegin(), heap.cend(), [timerId] (const QTimerInfo &v) {
         return v.Id() == timerId;
@@ -20,27 +22,27 @@ void MyHeapAdaptor::unregisterTimer(int timerId)
         heap.erase(it);
 }
 
-void MyHeapAdaptor::activate()
+template< class Heap >
+void MyHeapAdaptorT<Heap>::activate()
 {
-    QTimerInfo v = heap.top();
-    const TimeSpec t = v.timeoutRef();
-    do {
-        //heap.pop();
-        v.advance();
-        //heap.push(v);
-        //heap.update(heap.begin(), v);
-        heap.decrease(heap.cbegin(), v);
-        v = heap.top();
-    } while( v.timeoutRef() == t );
+    const TimeSpec t = heap.top().timeoutRef();
+    heap.reschedule_while([&t] (const QTimerInfo &v) { return v.timeoutRef() == t; },
+                          [] (QTimerInfo &v) { v.advance(); });
 }
 
-long MyHeapAdaptor::currentTopTime() const
+template< class Heap >
+long MyHeapAdaptorT<Heap>::currentTopTime() const
 {
     return heap.top().time();
 }
 
+template class MyHeapAdaptorT< MyTimerHeap<2> >;
+template class MyHeapAdaptorT< MyTimerHeap<4> >;
+template class MyHeapAdaptorT< MyTimerHeap<8> >;
+
 
-MyHeapAdaptorPtr1::~MyHeapAdaptorPtr1()
+template< class Heap >
+MyHeapAdaptorPtrT<Heap>::~MyHeapAdaptorPtrT()
 {
     if( heap.size() == 0 )
         return;
@@ -52,43 +54,48 @@ MyHeapAdaptorPtr1::~MyHeapAdaptorPtr1()
     heap.take(first).destroy();
 }
 
-int MyHeapAdaptorPtr1::registerTimer(int interval, int64_t current)
+template< class Heap >
+int MyHeapAdaptorPtrT<Heap>::registerTimer(int interval, int64_t current)
 {
     QTimerInfoPtr v;
     const int id = m_nextId++;
     v.create(id, interval, current);
     heap.push(v);
+    m_timers.push_back(v.info);
     return id;
 }
 
-void MyHeapAdaptorPtr1::unregisterTimer(int timerId)
+template< class Heap >
+void MyHeapAdaptorPtrT<Heap>::unregisterTimer(int timerId)
 {
-    auto it = std::find_if(heap.cbegin(), heap.cend(), [timerId] (QTimerInfoPtr ptr) {
-        return ptr.Id() == timerId;
-    });
-    if (it != heap.cend())
-        heap.take(it).destroy();
+    if( timerId < 0 || timerId >= int(m_timers.size()) || ! m_timers[timerId] )
+        return;
+
+    QTimerInfoPtr v;
+    v.info = m_timers[timerId];
+    m_timers[timerId] = nullptr;
+    heap.erase(v);
+    v.destroy();
 }
 
-void MyHeapAdaptorPtr1::activate()
+template< class Heap >
+void MyHeapAdaptorPtrT<Heap>::activate()
 {
-    QTimerInfoPtr v = heap.top();
-    const TimeSpec t = v.timeoutRef();
-    do {
-        //heap.pop();
-        v.advance();
-        //heap.push(v);
-        //heap.update(heap.begin(), v);
-        heap.decrease(heap.cbegin(), v);
-        v = heap.top();
-    } while( v.timeoutRef() == t );
+    const TimeSpec t = heap.top().timeoutRef();
+    heap.reschedule_while([&t] (const QTimerInfoPtr &v) { return v.timeoutRef() == t; },
+                          [] (QTimerInfoPtr &v) { v.advance(); });
 }
 
-long MyHeapAdaptorPtr1::currentTopTime() const
+template< class Heap >
+long MyHeapAdaptorPtrT<Heap>::currentTopTime() const
 {
     return heap.top().time();
 }
 
+template class MyHeapAdaptorPtrT< MyTimerPtrHeap<2> >;
+template class MyHeapAdaptorPtrT< MyTimerPtrHeap<8> >;
+template class MyHeapAdaptorPtrT< MyTimerPtrAlignedHeap >;
+
 
 MyHeapAdaptorPtr2::~MyHeapAdaptorPtr2()
 {
@@ -122,15 +129,9 @@ void MyHeapAdaptorPtr2::unregisterTimer(int timerId)
 
 void MyHeapAdaptorPtr2::activate()
 {
-    QTimerInfoPtr2 v = heap.top();
-    const TimeSpec t = v.timeoutRef();
-    do {
-        //heap.pop();
-        v.advance();
-        //heap.push(v);
-        heap.decrease(heap.cbegin(), v);
-        v = heap.top();
-    } while( v.timeoutRef() == t );
+    const TimeSpec t = heap.top().timeoutRef();
+    heap.reschedule_while([&t] (const QTimerInfoPtr2 &v) { return v.timeoutRef() == t; },
+                          [] (QTimerInfoPtr2 &v) { v.advance(); });
 }
 
 long MyHeapAdaptorPtr2::currentTopTime() const
@@ -165,14 +166,92 @@ void MyHeapAdaptorPtr3::unregisterTimer(int timerId)
 void MyHeapAdaptorPtr3::activate()
 {
     const TimeSpec t = heap.top()->timeoutRef();
-    do {
-        QTimerInfoPtr3 v = heap.pop_top();
-        v->advance();
-        heap.push(std::move(v));
-    } while( heap.top()->timeoutRef() == t );
+    heap.reschedule_while([&t] (const QTimerInfoPtr3 &v) { return v->timeoutRef() == t; },
+                          [] (QTimerInfoPtr3 &v) { v->advance(); });
 }
 
 long MyHeapAdaptorPtr3::currentTopTime() const
 {
     return heap.top()->time();
 }
+
+
+int MyHeapAdaptorSplit::registerTimer(int interval, int64_t current)
+{
+    QTimerInfo v;
+    const int id = m_nextId++;
+    v.create(id, interval, current);
+    heap.push(v.timeoutRef(), v);
+    return id;
+}
+
+void MyHeapAdaptorSplit::unregisterTimer(int timerId)
+{
+    for( auto it = heap.cbegin(), end = heap.cend(); it != end; ++it ) {
+        if( heap.payload(it).Id() == timerId ) {
+            heap.erase(it);
+            return;
+        }
+    }
+}
+
+void MyHeapAdaptorSplit::activate()
+{
+    const TimeSpec t = heap.top();
+    do {
+        QTimerInfo &v = heap.top_payload();
+        v.advance();
+        heap.decrease(heap.cbegin(), v.timeoutRef());
+    } while( heap.top() == t );
+}
+
+long MyHeapAdaptorSplit::currentTopTime() const
+{
+    return heap.top_payload().time();
+}
+
+
+template< bool Lazy >
+int MyHeapAdaptorHandleT<Lazy>::registerTimer(int interval, int64_t current)
+{
+    QTimerInfo v;
+    const int id = m_nextId++;
+    v.create(id, interval, current);
+    m_handles.push_back(heap.push(v));
+    return id;
+}
+
+template< bool Lazy >
+void MyHeapAdaptorHandleT<Lazy>::unregisterTimer(int timerId)
+{
+    if( timerId < 0 || timerId >= int(m_handles.size()) )
+        return;
+    const typename Heap::handle hd = m_handles[timerId];
+    if( ! heap.contains(hd) )
+        return;
+    if( Lazy )
+        heap.lazy_erase(hd);
+    else
+        heap.erase(hd);
+}
+
+template< bool Lazy >
+void MyHeapAdaptorHandleT<Lazy>::activate()
+{
+    QTimerInfo v = heap.top();
+    const TimeSpec t = v.timeoutRef();
+    do {
+        v.advance();
+        heap.decrease(heap.top_handle(), v);
+        v = heap.top();
+    } while( v.timeoutRef() == t );
+}
+
+template< bool Lazy >
+long MyHeapAdaptorHandleT<Lazy>::currentTopTime() const
+{
+    return heap.top().time();
+}
+
+template class MyHeapAdaptorHandleT<false>;
+template class MyHeapAdaptorHandleT<true>;
@@ -3,8 +3,13 @@
 
 #include "timerdata.h"
 #include "binary_heap.h"
+#include "split_heap.h"
+#include "handle_heap.h"
 
-class MyHeapAdaptor {
+#include <vector>
+
+template< class Heap >
+class MyHeapAdaptorT {
 public:
     int registerTimer(int interval, int64_t current = 0);
 
@@ -15,13 +20,27 @@ public:
     long currentTopTime() const;
 
 private:
-    binary_max_heap::heap<QTimerInfo, std::greater<QTimerInfo> > heap;
+    Heap heap;
     int m_nextId = 0;
 };
 
-class MyHeapAdaptorPtr1 {
+template< std::size_t Arity >
+using MyTimerHeap = binary_max_heap::heap<QTimerInfo, std::greater<QTimerInfo>,
+                                          binary_max_heap::position_tracker_nop,
+                                          std::allocator<QTimerInfo>, Arity>;
+
+extern template class MyHeapAdaptorT< MyTimerHeap<2> >;
+extern template class MyHeapAdaptorT< MyTimerHeap<4> >;
+extern template class MyHeapAdaptorT< MyTimerHeap<8> >;
+
+typedef MyHeapAdaptorT< MyTimerHeap<2> > MyHeapAdaptor;
+typedef MyHeapAdaptorT< MyTimerHeap<4> > MyHeapAdaptor4;
+typedef MyHeapAdaptorT< MyTimerHeap<8> > MyHeapAdaptor8;
+
+template< class Heap >
+class MyHeapAdaptorPtrT {
 public:
-    ~MyHeapAdaptorPtr1();
+    ~MyHeapAdaptorPtrT();
 
     int registerTimer(int interval, int64_t current = 0);
 
@@ -32,10 +51,31 @@ public:
     long currentTopTime() const;
 
 private:
-    binary_max_heap::heap<QTimerInfoPtr, std::greater<QTimerInfoPtr> > heap;
+    Heap heap;
+    std::vector<QTimerInfo*> m_timers; // id -> timer, nullptr if unregistered
     int m_nextId = 0;
 };
 
+// Heap positions are stored in QTimerInfo::heapIndex, so no search is needed to unregister
+typedef binary_max_heap::intrusive_position_tracker<QTimerInfo, int, &QTimerInfo::heapIndex> QTimerInfoTracker;
+
+template< std::size_t Arity >
+using MyTimerPtrHeap = binary_max_heap::heap<QTimerInfoPtr, std::greater<QTimerInfoPtr>,
+                                             QTimerInfoTracker,
+                                             std::allocator<QTimerInfoPtr>, Arity>;
+
+// 8 pointer sized entries per sibling group, i.e. one cache line each
+using MyTimerPtrAlignedHeap = binary_max_heap::cache_aligned_heap<QTimerInfoPtr, std::greater<QTimerInfoPtr>,
+                                                                  QTimerInfoTracker, 8>;
+
+extern template class MyHeapAdaptorPtrT< MyTimerPtrHeap<2> >;
+extern template class MyHeapAdaptorPtrT< MyTimerPtrHeap<8> >;
+extern template class MyHeapAdaptorPtrT< MyTimerPtrAlignedHeap >;
+
+typedef MyHeapAdaptorPtrT< MyTimerPtrHeap<2> > MyHeapAdaptorPtr1;
+typedef MyHeapAdaptorPtrT< MyTimerPtrHeap<8> > MyHeapAdaptorPtr8;
+typedef MyHeapAdaptorPtrT< MyTimerPtrAlignedHeap > MyHeapAdaptorPtr8Aligned;
+
 class MyHeapAdaptorPtr2 {
 public:
     ~MyHeapAdaptorPtr2();
@@ -70,4 +110,47 @@ private:
     int m_nextId = 0;
 };
 
+// Keys (timeouts) and payloads (the full QTimerInfo) in separate arrays
+class MyHeapAdaptorSplit {
+public:
+    int registerTimer(int interval, int64_t current = 0);
+
+    void unregisterTimer(int timerId);
+
+    void activate();
+
+    long currentTopTime() const;
+
+private:
+    binary_max_heap::split_heap<TimeSpec, QTimerInfo, std::greater<TimeSpec> > heap;
+    int m_nextId = 0;
+};
+
+// Timer id -> handle map, so unregisterTimer does not need to search
+// Lazy unregisters only mark the timer (handle_heap::lazy_erase)
+template< bool Lazy >
+class MyHeapAdaptorHandleT {
+public:
+    int registerTimer(int interval, int64_t current = 0);
+
+    void unregisterTimer(int timerId);
+
+    void activate();
+
+    long currentTopTime() const;
+
+private:
+    typedef binary_max_heap::handle_heap<QTimerInfo, std::greater<QTimerInfo> > Heap;
+
+    Heap heap;
+    std::vector<typename Heap::handle> m_handles;
+    int m_nextId = 0;
+};
+
+extern template class MyHeapAdaptorHandleT<false>;
+extern template class MyHeapAdaptorHandleT<true>;
+
+typedef MyHeapAdaptorHandleT<false> MyHeapAdaptorHandle;
+typedef MyHeapAdaptorHandleT<true> MyHeapAdaptorHandleLazy;
+
 #endif // MYHEAPADAPTOR_H
@@ -0,0 +1,71 @@
+#include "radixheapadaptor.h"
+
+RadixHeapAdaptor::~RadixHeapAdaptor()
+{
+    while( ! heap.empty() )
+        delete heap.pop_top();
+}
+
+int RadixHeapAdaptor::registerTimer(int interval, int64_t current)
+{
+    QTimerInfo *t = new QTimerInfo;
+    const int id = m_nextId++;
+    t->create(id, interval, current);
+    heap.push(t);
+    m_timers.push_back(t);
+    dropCancelled();
+    return id;
+}
+
+void RadixHeapAdaptor::unregisterTimer(int timerId)
+{
+    if( timerId < 0 || timerId >= int(m_timers.size()) || ! m_timers[timerId] )
+        return;
+
+    m_timers[timerId]->id = -1;
+    m_timers[timerId] = nullptr;
+    ++m_cancelled;
+
+    if( m_cancelled > heap.size() / 2 ) {
+        heap.erase_if([] (QTimerInfo *t) {
+            if( t->id >= 0 )
+                return false;
+            delete t;
+            return true;
+        });
+        m_cancelled = 0;
+    }
+    dropCancelled();
+}
+
+void RadixHeapAdaptor::activate()
+{
+    const TimeSpec t = heap.top()->timeoutRef();
+    do {
+        QTimerInfo *n = heap.pop_top();
+        if( n->id < 0 ) {
+            delete n;
+            --m_cancelled;
+            continue;
+        }
+        n->advance();
+        heap.push(n);
+    } while( ! heap.empty() && heap.top()->timeoutRef() == t );
+
+    dropCancelled();
+}
+
+long RadixHeapAdaptor::currentTopTime() const
+{
+    return m_top->time();
+}
+
+// Keeps a live timer on top, so that currentTopTime() is right
+void RadixHeapAdaptor::dropCancelled()
+{
+    while( ! heap.empty() && heap.top()->id < 0 ) {
+        delete heap.pop_top();
+        --m_cancelled;
+    }
+    m_top = heap.empty() ? nullptr : heap.top();
+}
@@ -0,0 +1,44 @@
+#ifndef RADIXHEAPADAPTOR_H
+#define RADIXHEAPADAPTOR_H
+
+#include "timerdata.h"
+#include "radix_heap.h"
+
+#include <cstdint>
+#include <vector>
+
+// Timer deadlines only grow, so they can be kept in a radix heap, keyed by
+// the timeout in nanoseconds. The radix heap cannot remove arbitrary
+// elements, so unregistered timers are only marked, and dropped once they
+// reach the top or, when they make up most of the heap, all at once.
+class RadixHeapAdaptor
+{
+public:
+    ~RadixHeapAdaptor();
+
+    int registerTimer(int interval, int64_t current = 0);
+
+    void unregisterTimer(int timerId);
+
+    void activate();
+
+    long currentTopTime() const;
+
+private:
+    struct TimeoutKey {
+        uint64_t operator()(const QTimerInfo *t) const
+        {
+            return uint64_t(t->timeout.tv_sec) * 1000000000u + uint64_t(t->timeout.tv_nsec);
+        }
+    };
+
+    void dropCancelled();
+
+    binary_max_heap::radix_heap<QTimerInfo*, TimeoutKey> heap;
+    QTimerInfo *m_top = nullptr; // heap.top(), which is not const
+    std::vector<QTimerInfo*> m_timers; // id -> timer, nullptr if unregistered
+    std::size_t m_cancelled = 0; // marked timers still in the heap
+    int m_nextId = 0;
+};
+
+#endif // RADIXHEAPADAPTOR_H
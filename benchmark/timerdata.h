@@ -15,6 +15,7 @@ struct QTimerInfo {
     int id = -2;                // - timer identifier
     int interval = 0;           // - timer interval
     int timerType = 0;          // - timer type
+    int heapIndex = -1;         // - position in the heap (intrusive position tracker), fits into padding
     TimeSpec timeout = {0, 0};  // - when to actually fire
     void *obj = nullptr;        // - object to receive event
     QTimerInfo **activateRef = nullptr; // - ref from activateTimers
@@ -92,6 +93,11 @@ struct QTimerInfoPtr {
         delete info;
     }
 
+    QTimerInfo &operator*() const
+    {
+        return *info;
+    }
+
     int Id() const
     {
         return info->id;
@@ -0,0 +1,195 @@
+#include "timerwheeladaptor.h"
+
+#include <algorithm>
+#include <limits>
+
+TimerWheelAdaptor::~TimerWheelAdaptor()
+{
+    for( Node *n : m_timers )
+        delete n;
+}
+
+int TimerWheelAdaptor::registerTimer(int interval, int64_t current)
+{
+    Node *n = new Node;
+    const int id = m_nextId++;
+    n->create(id, interval, current);
+    m_timers.push_back(n);
+    ++m_count;
+
+    insert(n);
+    advanceToNext();
+    return id;
+}
+
+void TimerWheelAdaptor::unregisterTimer(int timerId)
+{
+    if( timerId < 0 || timerId >= int(m_timers.size()) || ! m_timers[timerId] )
+        return;
+
+    Node *n = m_timers[timerId];
+    m_timers[timerId] = nullptr;
+    if( n->heapIndex != Tracker::npos )
+        m_overflow.erase(n);
+    else
+        unlink(n);
+    delete n;
+    --m_count;
+
+    advanceToNext();
+}
+
+void TimerWheelAdaptor::activate()
+{
+    // the current slot holds exactly the timers due now
+    const int slot = int(m_now & (s_level0Size - 1));
+    Node *n = m_level0[slot];
+    m_level0[slot] = nullptr;
+    m_level0Used[slot / 64] &= ~(uint64_t(1) << (slot % 64));
+
+    while( n ) {
+        Node *next = n->next;
+        n->advance();
+        insert(n);
+        n = next;
+    }
+
+    advanceToNext();
+}
+
+long TimerWheelAdaptor::currentTopTime() const
+{
+    return m_now;
+}
+
+void TimerWheelAdaptor::insert(Node *n)
+{
+    const long t = std::max(n->time(), m_now);
+    n->level0Slot = -1;
+
+    if( t - m_now < s_level0Size ) {
+        const int slot = int(t & (s_level0Size - 1));
+        link(&m_level0[slot], n);
+        n->level0Slot = slot;
+        m_level0Used[slot / 64] |= uint64_t(1) << (slot % 64);
+        return;
+    }
+
+    for( int level = 0; level < 2; ++level ) {
+        const int shift = s_level0Bits + level * s_upperBits;
+        if( (t >> shift) - (m_now >> shift) < s_upperSize ) {
+            link(&m_upper[level][(t >> shift) & (s_upperSize - 1)], n);
+            return;
+        }
+    }
+
+    m_overflow.push(n);
+}
+
+void TimerWheelAdaptor::link(Node **head, Node *n)
+{
+    n->next = *head;
+    n->pprev = head;
+    if( *head )
+        (*head)->pprev = &n->next;
+    *head = n;
+}
+
+void TimerWheelAdaptor::unlink(Node *n)
+{
+    *n->pprev = n->next;
+    if( n->next )
+        n->next->pprev = n->pprev;
+
+    const int slot = n->level0Slot;
+    if( slot >= 0 && ! m_level0[slot] )
+        m_level0Used[slot / 64] &= ~(uint64_t(1) << (slot % 64));
+    n->level0Slot = -1;
+}
+
+void TimerWheelAdaptor::cascade(Node **head)
+{
+    Node *n = *head;
+    *head = nullptr;
+    while( n ) {
+        Node *next = n->next;
+        insert(n);
+        n = next;
+    }
+}
+
+// Moves m_now forward to the earliest timeout, cascading the upper levels
+// whenever a new block of their granularity is entered. Blocks in which
+// nothing is due or to be cascaded are skipped.
+void TimerWheelAdaptor::advanceToNext()
+{
+    if( m_count == 0 )
+        return;
+
+    for( ;; ) {
+        // level 0 slots before the current one belong to the next block
+        const int slot = nextLevel0Slot(int(m_now & (s_level0Size - 1)));
+        if( slot >= 0 ) {
+            m_now = (m_now & ~long(s_level0Size - 1)) + slot;
+            return;
+        }
+
+        bool level0Empty = true;
+        for( uint64_t bits : m_level0Used )
+            level0Empty = level0Empty && bits == 0;
+        const long next = level0Empty ? nextCascadeBlock() : (m_now >> s_level0Bits) + 1;
+        m_now = next << s_level0Bits;
+
+        const long block1 = m_now >> s_level0Bits;
+        if( (block1 & (s_upperSize - 1)) == 0 ) {
+            const int shift = s_level0Bits + s_upperBits;
+            const long block2 = m_now >> shift;
+            while( ! m_overflow.empty()
+                   && (m_overflow.top()->time() >> shift) - block2 < s_upperSize )
+                insert(m_overflow.pop_top());
+            cascade(&m_upper[1][block2 & (s_upperSize - 1)]);
+        }
+        cascade(&m_upper[0][block1 & (s_upperSize - 1)]);
+    }
+}
+
+// First block of level 0 size after the current one that has a level 1 or 2
+// slot to cascade, or in which the top of the overflow heap gets close
+// enough to be cascaded into level 2
+long TimerWheelAdaptor::nextCascadeBlock() const
+{
+    const int shift = s_level0Bits + s_upperBits;
+    const long block1 = m_now >> s_level0Bits;
+    const long block2 = m_now >> shift;
+
+    long next = std::numeric_limits<long>::max();
+    for( long b = block1 + 1; b < block1 + s_upperSize; ++b ) {
+        if( m_upper[0][b & (s_upperSize - 1)] ) {
+            next = b;
+            break;
+        }
+    }
+    for( long b = block2 + 1; b < block2 + s_upperSize && (b << s_upperBits) < next; ++b ) {
+        if( m_upper[1][b & (s_upperSize - 1)] ) {
+            next = b << s_upperBits;
+            break;
+        }
+    }
+    if( ! m_overflow.empty() ) {
+        const long b = std::max(block2 + 1, (m_overflow.top()->time() >> shift) - (s_upperSize - 1));
+        next = std::min(next, b << s_upperBits);
+    }
+    return next;
+}
+
+int TimerWheelAdaptor::nextLevel0Slot(int from) const
+{
+    for( int word = from / 64; word < s_level0Size / 64; ++word ) {
+        uint64_t bits = m_level0Used[word];
+        if( word == from / 64 )
+            bits &= ~uint64_t(0) << (from % 64);
+        if( bits )
+            return word * 64 + __builtin_ctzll(bits);
+    }
+    return -1;
+}
@@ -0,0 +1,66 @@
+#ifndef TIMERWHEELADAPTOR_H
+#define TIMERWHEELADAPTOR_H
+
+#include "timerdata.h"
+#include "binary_heap.h"
+
+#include <cstdint>
+#include <vector>
+
+// Hierarchical timing wheel: timers due within the next 256 ticks sit in the
+// slots of level 0 (one tick per slot), later ones in the 64 slots of level 1
+// (256 ticks per slot) or level 2 (16384 ticks per slot), and everything
+// further away in a heap. Insert and cancel are O(1) for wheel timers; the
+// slots of the upper levels and the heap are cascaded down as time advances.
+// Timers registered in the past fire at the next activate().
+class TimerWheelAdaptor
+{
+public:
+    ~TimerWheelAdaptor();
+
+    int registerTimer(int interval, int64_t current = 0);
+
+    void unregisterTimer(int timerId);
+
+    void activate();
+
+    long currentTopTime() const;
+
+private:
+    struct Node : QTimerInfo {
+        Node *next = nullptr;
+        Node **pprev = nullptr; // link pointing to this node, for O(1) unlinking
+        int level0Slot = -1;
+    };
+
+    struct Later {
+        bool operator()(const Node *lhs, const Node *rhs) const { return *lhs > *rhs; }
+    };
+
+    typedef binary_max_heap::intrusive_position_tracker<QTimerInfo, int, &QTimerInfo::heapIndex> Tracker;
+    typedef binary_max_heap::heap<Node*, Later, Tracker> OverflowHeap;
+
+    static const int s_level0Bits = 8;
+    static const int s_upperBits = 6;
+    static const int s_level0Size = 1 << s_level0Bits;
+    static const int s_upperSize = 1 << s_upperBits;
+
+    void insert(Node *n);
+    void link(Node **head, Node *n);
+    void unlink(Node *n);
+    void cascade(Node **head);
+    void advanceToNext();
+    long nextCascadeBlock() const;
+    int nextLevel0Slot(int from) const;
+
+    Node *m_level0[s_level0Size] = {};
+    Node *m_upper[2][s_upperSize] = {};
+    uint64_t m_level0Used[s_level0Size / 64] = {};
+    OverflowHeap m_overflow;
+    std::vector<Node*> m_timers; // id -> timer, nullptr if unregistered
+    long m_now = 0;              // earliest timeout, if there are timers
+    std::size_t m_count = 0;
+    int m_nextId = 0;
+};
+
+#endif // TIMERWHEELADAPTOR_H
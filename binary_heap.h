@@ -18,43 +18,481 @@
 #ifndef BINARY_MAX_HEAP_H
 #define BINARY_MAX_HEAP_H
 
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
 #include <memory>
+#include <thread>
+#include <type_traits>
 #include <vector>
 
+#if defined(BINARY_MAX_HEAP_SIMD) && (defined(__SSE4_1__) || defined(__AVX2__))
+#include <immintrin.h>
+#endif
+
 namespace binary_max_heap {
 
-/// Standard textbook binary heap algorithms.
+/// Index math of the standard implicit d-ary heap: the children of node i
+/// are stored contiguously at Arity * i + 1 ... Arity * (i + 1).
+template< std::size_t Arity >
+struct d_ary_layout {
+    static_assert(Arity >= 2, "heap arity must be at least 2");
+
+    static constexpr std::size_t arity = Arity;
+
+    template< typename D >
+    static D parent_index(const D idx) { return (idx - 1) / D(Arity); }
+
+    template< typename D >
+    static D first_child_index(const D idx) { return D(Arity) * idx + 1; }
+
+    /// Distance between the indices of consecutive children of idx.
+    template< typename D >
+    static D child_stride(const D /*idx*/) { return 1; }
+
+    /// An upper bound for the index of the last node having children in a
+    /// heap of the given size (-1 if there is none).
+    template< typename D >
+    static D last_parent_index(const D size) { return size < 2 ? -1 : parent_index(size - 1); }
+};
+
+template< std::size_t Arity >
+constexpr std::size_t d_ary_layout<Arity>::arity;
+
+
+/// Index math of a B-heap: the tree is cut into blocks, each holding a
+/// complete Arity-ary subtree of BlockHeight levels, and blocks are stored
+/// contiguously in the order of the (Arity^BlockHeight)-ary tree they form.
+/// With a block of about a memory page (or a few cache lines), a sift walks
+/// BlockHeight levels within one page before touching the next one, so very
+/// large heaps take a TLB/cache miss every BlockHeight levels instead of on
+/// every level.
+/// Every prefix of the array still forms a tree (the parent of a node always
+/// has a smaller index), hence the usual push/pop algorithms apply; only
+/// the children of the bottom nodes of a block are not adjacent but one
+/// block apart. Note that a heap in this layout is not level-balanced: it
+/// fills one block after the other, which adds at most BlockHeight levels
+/// to the depth.
+template< std::size_t Arity, std::size_t BlockHeight >
+struct b_heap_layout {
+    static_assert(Arity >= 2, "heap arity must be at least 2");
+    static_assert(BlockHeight >= 2, "a block must have at least two levels");
+
+    static constexpr std::size_t arity = Arity;
+
+private:
+    static constexpr std::size_t power(std::size_t base, std::size_t exp)
+    {
+        return exp == 0 ? 1 : base * power(base, exp - 1);
+    }
+
+public:
+    /// Child blocks per block
+    static constexpr std::size_t block_fanout = power(Arity, BlockHeight);
+    /// Nodes per block
+    static constexpr std::size_t block_size = (block_fanout - 1) / (Arity - 1);
+    /// Block local index of the first node at the bottom level of a block
+    static constexpr std::size_t block_first_leaf = (block_size - 1) / Arity;
+
+    template< typename D >
+    static D parent_index(const D idx)
+    {
+        const D block = idx / D(block_size);
+        const D local = idx % D(block_size);
+        if( local > 0 )
+            return block * D(block_size) + (local - 1) / D(Arity);
+
+        const D j = block - 1;
+        const D parentBlock = j / D(block_fanout);
+        return parentBlock * D(block_size) + D(block_first_leaf) + (j % D(block_fanout)) / D(Arity);
+    }
+
+    template< typename D >
+    static D first_child_index(const D idx)
+    {
+        const D block = idx / D(block_size);
+        const D local = idx % D(block_size);
+        if( local < D(block_first_leaf) )
+            return block * D(block_size) + D(Arity) * local + 1;
+
+        const D childBlock = block * D(block_fanout) + 1 + (local - D(block_first_leaf)) * D(Arity);
+        return childBlock * D(block_size);
+    }
+
+    template< typename D >
+    static D child_stride(const D idx)
+    {
+        return idx % D(block_size) < D(block_first_leaf) ? D(1) : D(block_size);
+    }
+
+    template< typename D >
+    static D last_parent_index(const D size) { return size - 1; }
+};
+
+template< std::size_t Arity, std::size_t BlockHeight >
+constexpr std::size_t b_heap_layout<Arity, BlockHeight>::arity;
+template< std::size_t Arity, std::size_t BlockHeight >
+constexpr std::size_t b_heap_layout<Arity, BlockHeight>::block_fanout;
+template< std::size_t Arity, std::size_t BlockHeight >
+constexpr std::size_t b_heap_layout<Arity, BlockHeight>::block_size;
+template< std::size_t Arity, std::size_t BlockHeight >
+constexpr std::size_t b_heap_layout<Arity, BlockHeight>::block_first_leaf;
+
+/// Height of the largest complete Arity-ary tree with at most the given
+/// number of nodes, e.g. to derive a b_heap_layout block from a page size.
+constexpr std::size_t complete_tree_height(std::size_t nodes, std::size_t arity)
+{
+    return nodes == 0 ? 0 : 1 + complete_tree_height((nodes - 1) / arity, arity);
+}
+
+
+/// True if Iterator addresses contiguous memory (raw pointers and the
+/// iterators of std::vector with the default allocator).
+template< typename Iterator >
+struct is_contiguous_iterator
+    : std::integral_constant<bool, std::is_pointer<Iterator>::value
+                                   || std::is_same<Iterator, typename std::vector<
+                                          typename std::iterator_traits<Iterator>::value_type>::iterator>::value>
+{};
+
+
+/// Vectorized selection of the greatest (Max) or smallest of Arity
+/// contiguous values; returns the offset of the selected value.
+/// The specializations below are only available when BINARY_MAX_HEAP_SIMD
+/// is defined and the corresponding instruction sets are enabled at compile
+/// time. They are opt-in because the branch-free selection makes the next
+/// load of a sift depend on the compare result, while the scalar loop lets
+/// the CPU speculate into the next level; which one is faster depends on
+/// the machine and the workload, so measure before enabling it.
+template< typename T, std::size_t Arity >
+struct simd_select {
+    static constexpr bool enabled = false;
+};
+
+#if defined(BINARY_MAX_HEAP_SIMD) && defined(__GNUC__) && defined(__SSE4_1__)
+
+namespace simd_detail {
+
+inline __m128 vmax(__m128 a, __m128 b, std::true_type) { return _mm_max_ps(a, b); }
+inline __m128 vmax(__m128 a, __m128 b, std::false_type) { return _mm_min_ps(a, b); }
+inline __m128i vmax(__m128i a, __m128i b, std::true_type) { return _mm_max_epi32(a, b); }
+inline __m128i vmax(__m128i a, __m128i b, std::false_type) { return _mm_min_epi32(a, b); }
+
+// Broadcasts the extreme value of the 4 lanes of v into all lanes
+template< typename Max >
+inline __m128 reduce(__m128 v, Max max)
+{
+    v = vmax(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1)), max);
+    return vmax(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 0, 3, 2)), max);
+}
+
+template< typename Max >
+inline __m128i reduce(__m128i v, Max max)
+{
+    v = vmax(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1)), max);
+    return vmax(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2)), max);
+}
+
+inline int equal_mask(__m128 a, __m128 b) { return _mm_movemask_ps(_mm_cmpeq_ps(a, b)); }
+inline int equal_mask(__m128i a, __m128i b) { return _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(a, b))); }
+
+// Index of the first set bit; the mask is only empty for unordered values (NaN)
+inline std::size_t first_set(int mask) { return mask ? std::size_t(__builtin_ctz(unsigned(mask))) : 0; }
+
+template< typename Vec, typename Max >
+inline std::size_t select4(Vec v, Max max)
+{
+    return first_set(equal_mask(v, reduce(v, max)));
+}
+
+} // namespace simd_detail
+
+template<>
+struct simd_select<float, 4> {
+    static constexpr bool enabled = true;
+    template< bool Max >
+    static std::size_t select(const float *p)
+    {
+        return simd_detail::select4(_mm_loadu_ps(p), std::integral_constant<bool, Max>());
+    }
+};
+
+template<>
+struct simd_select<std::int32_t, 4> {
+    static constexpr bool enabled = true;
+    template< bool Max >
+    static std::size_t select(const std::int32_t *p)
+    {
+        return simd_detail::select4(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)),
+                                    std::integral_constant<bool, Max>());
+    }
+};
+
+#endif // __SSE4_1__
+
+#if defined(BINARY_MAX_HEAP_SIMD) && defined(__GNUC__) && defined(__AVX2__)
+
+namespace simd_detail {
+
+inline __m256 vmax(__m256 a, __m256 b, std::true_type) { return _mm256_max_ps(a, b); }
+inline __m256 vmax(__m256 a, __m256 b, std::false_type) { return _mm256_min_ps(a, b); }
+inline __m256d vmax(__m256d a, __m256d b, std::true_type) { return _mm256_max_pd(a, b); }
+inline __m256d vmax(__m256d a, __m256d b, std::false_type) { return _mm256_min_pd(a, b); }
+
+// 64 bit integers have no min/max instruction: compare and blend
+inline __m256i vmax(__m256i a, __m256i b, std::true_type) { return _mm256_blendv_epi8(a, b, _mm256_cmpgt_epi64(b, a)); }
+inline __m256i vmax(__m256i a, __m256i b, std::false_type) { return _mm256_blendv_epi8(a, b, _mm256_cmpgt_epi64(a, b)); }
+
+template< typename Max >
+inline __m256 reduce(__m256 v, Max max)
+{
+    v = vmax(v, _mm256_permute2f128_ps(v, v, 1), max);
+    v = vmax(v, _mm256_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1)), max);
+    return vmax(v, _mm256_shuffle_ps(v, v, _MM_SHUFFLE(1, 0, 3, 2)), max);
+}
+
+template< typename Max >
+inline __m256d reduce(__m256d v, Max max)
+{
+    v = vmax(v, _mm256_permute2f128_pd(v, v, 1), max);
+    return vmax(v, _mm256_permute_pd(v, 5), max);
+}
+
+template< typename Max >
+inline __m256i reduce(__m256i v, Max max)
+{
+    v = vmax(v, _mm256_permute4x64_epi64(v, _MM_SHUFFLE(1, 0, 3, 2)), max);
+    return vmax(v, _mm256_permute4x64_epi64(v, _MM_SHUFFLE(2, 3, 0, 1)), max);
+}
+
+inline int equal_mask(__m256 a, __m256 b) { return _mm256_movemask_ps(_mm256_cmp_ps(a, b, _CMP_EQ_OQ)); }
+inline int equal_mask(__m256d a, __m256d b) { return _mm256_movemask_pd(_mm256_cmp_pd(a, b, _CMP_EQ_OQ)); }
+inline int equal_mask(__m256i a, __m256i b) { return _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(a, b))); }
+
+template< typename Vec, typename Max >
+inline std::size_t select256(Vec v, Max max)
+{
+    return first_set(equal_mask(v, reduce(v, max)));
+}
+
+// Two vectors of 4 (64 bit) lanes each
+template< typename Vec, typename Max >
+inline std::size_t select8(Vec a, Vec b, Max max)
+{
+    const Vec m = reduce(vmax(a, b, max), max);
+    return first_set(equal_mask(a, m) | (equal_mask(b, m) << 4));
+}
+
+} // namespace simd_detail
+
+template<>
+struct simd_select<float, 8> {
+    static constexpr bool enabled = true;
+    template< bool Max >
+    static std::size_t select(const float *p)
+    {
+        return simd_detail::select256(_mm256_loadu_ps(p), std::integral_constant<bool, Max>());
+    }
+};
+
+template<>
+struct simd_select<std::int32_t, 8> {
+    static constexpr bool enabled = true;
+    template< bool Max >
+    static std::size_t select(const std::int32_t *p)
+    {
+        // The __m256i helpers above work on 64 bit lanes, reduce 32 bit lanes here
+        const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        __m256i m = Max ? _mm256_max_epi32(v, _mm256_permute2x128_si256(v, v, 1))
+                        : _mm256_min_epi32(v, _mm256_permute2x128_si256(v, v, 1));
+        const __m256i s1 = _mm256_shuffle_epi32(m, _MM_SHUFFLE(2, 3, 0, 1));
+        m = Max ? _mm256_max_epi32(m, s1) : _mm256_min_epi32(m, s1);
+        const __m256i s2 = _mm256_shuffle_epi32(m, _MM_SHUFFLE(1, 0, 3, 2));
+        m = Max ? _mm256_max_epi32(m, s2) : _mm256_min_epi32(m, s2);
+        return simd_detail::first_set(_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(v, m))));
+    }
+};
+
+template<>
+struct simd_select<double, 4> {
+    static constexpr bool enabled = true;
+    template< bool Max >
+    static std::size_t select(const double *p)
+    {
+        return simd_detail::select256(_mm256_loadu_pd(p), std::integral_constant<bool, Max>());
+    }
+};
+
+template<>
+struct simd_select<double, 8> {
+    static constexpr bool enabled = true;
+    template< bool Max >
+    static std::size_t select(const double *p)
+    {
+        return simd_detail::select8(_mm256_loadu_pd(p), _mm256_loadu_pd(p + 4),
+                                    std::integral_constant<bool, Max>());
+    }
+};
+
+template<>
+struct simd_select<std::int64_t, 4> {
+    static constexpr bool enabled = true;
+    template< bool Max >
+    static std::size_t select(const std::int64_t *p)
+    {
+        return simd_detail::select256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)),
+                                      std::integral_constant<bool, Max>());
+    }
+};
+
+template<>
+struct simd_select<std::int64_t, 8> {
+    static constexpr bool enabled = true;
+    template< bool Max >
+    static std::size_t select(const std::int64_t *p)
+    {
+        return simd_detail::select8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)),
+                                    _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 4)),
+                                    std::integral_constant<bool, Max>());
+    }
+};
+
+#endif // __AVX2__
+
+
+/// Chooses the vectorized child selection for the comparators with a known
+/// meaning: std::less (max-heap) and std::greater (min-heap).
+template< typename T, class Compare, std::size_t Arity >
+struct simd_child_selector {
+    static constexpr bool enabled = false;
+};
+
+template< typename T, std::size_t Arity >
+struct simd_child_selector<T, std::less<T>, Arity> {
+    static constexpr bool enabled = simd_select<T, Arity>::enabled;
+    static std::size_t select(const T *p) { return simd_select<T, Arity>::template select<true>(p); }
+};
+
+template< typename T, std::size_t Arity >
+struct simd_child_selector<T, std::greater<T>, Arity> {
+    static constexpr bool enabled = simd_select<T, Arity>::enabled;
+    static std::size_t select(const T *p) { return simd_select<T, Arity>::template select<false>(p); }
+};
+
+
+/// Standard textbook d-ary heap algorithms (binary heap by default).
 /// The Heap template is expected to have a slightly augmented API compared to
 /// std::vector. See the default heap implementation for an example usage.
-template< class Heap >
+/// Arity is the number of children per node; the children of a node are
+/// stored next to each other, so for small value types a larger arity (e.g. 4
+/// or 8) keeps all children in one cache line and reduces the tree depth.
+/// Layout provides the index math (see d_ary_layout and b_heap_layout).
+template< class Heap, std::size_t Arity = 2, class Layout = d_ary_layout<Arity> >
 struct algorithm {
     typedef typename Heap::value_type             value_type;
     typedef typename Heap::iterator               iterator;
     typedef typename Heap::difference_type        difference_type;
     typedef typename Heap::compare_type           compare_type;
+    typedef Layout                                layout_type;
+
+    static_assert(Arity >= 2, "heap arity must be at least 2");
+    static_assert(Layout::arity == Arity, "Layout arity mismatch");
+
+    static constexpr difference_type arity = Arity;
 
     // Index helper
 
     static difference_type parent_index(const difference_type idx)
     {
-        return (idx - 1) / 2;
+        return Layout::parent_index(idx);
+    }
+
+    static difference_type first_child_index(const difference_type idx)
+    {
+        return Layout::first_child_index(idx);
+    }
+
+    static difference_type child_stride(const difference_type idx)
+    {
+        return Layout::child_stride(idx);
     }
 
     static difference_type second_child_index(const difference_type idx)
     {
-        return 2 * (idx + 1);
+        return first_child_index(idx) + child_stride(idx);
     }
 
-    static difference_type first_child_index(const difference_type idx)
+    static difference_type last_child_index(const difference_type idx)
     {
-        return second_child_index(idx) - 1;
+        return first_child_index(idx) + (arity - 1) * child_stride(idx);
     }
 
+    /// Returns the first position from which on all elements are leaves.
     static iterator first_leaf(Heap *heap)
     {
         const iterator first = heap->begin();
         const difference_type size = heap->end() - first;
-        return first + (size / 2);
+        return first + (Layout::last_parent_index(size) + 1);
+    }
+
+    /// Returns the index of the greatest of the count children starting at
+    /// index child (stride apart); ties are resolved in favor of the later child.
+    static difference_type max_child(const compare_type& comp,
+                                     const iterator first,
+                                     const difference_type child,
+                                     const difference_type count,
+                                     const difference_type stride = 1)
+    {
+        difference_type maxIdx = child + (count - 1) * stride;
+        for( difference_type c = maxIdx - stride; c >= child; c -= stride ) {
+            if( comp(*(first + maxIdx), *(first + c)) )
+                maxIdx = c;
+        }
+        return maxIdx;
+    }
+
+    /// Whether complete groups of adjacent children are compared with SIMD
+    /// instructions (arithmetic value types with std::less or std::greater
+    /// in contiguous storage, if enabled with BINARY_MAX_HEAP_SIMD, see
+    /// simd_select).
+    static constexpr bool simd_children = simd_child_selector<value_type, compare_type, Arity>::enabled
+                                          && is_contiguous_iterator<iterator>::value;
+
+    /// Returns the index of the greatest child of idx in a heap of the given
+    /// size, where child is first_child_index(idx) and less than size.
+    static difference_type max_present_child(const compare_type& comp,
+                                             const iterator first,
+                                             const difference_type idx,
+                                             const difference_type child,
+                                             const difference_type size)
+    {
+        const difference_type stride = child_stride(idx);
+        if( child + (arity - 1) * stride < size ) {
+            if( stride == 1 )
+                return max_adjacent_children(comp, first, child, std::integral_constant<bool, simd_children>());
+            return max_child(comp, first, child, arity, stride);
+        }
+        return max_child(comp, first, child, (size - child + stride - 1) / stride, stride);
+    }
+
+    static difference_type max_adjacent_children(const compare_type& comp,
+                                                 const iterator first,
+                                                 const difference_type child,
+                                                 std::false_type /*simd*/)
+    {
+        return max_child(comp, first, child, arity);
+    }
+
+    static difference_type max_adjacent_children(const compare_type& /*comp*/,
+                                                 const iterator first,
+                                                 const difference_type child,
+                                                 std::true_type /*simd*/)
+    {
+        typedef simd_child_selector<value_type, compare_type, Arity> selector;
+        return child + difference_type(selector::select(&*(first + child)));
     }
 
     // Basic algorithms
@@ -88,18 +526,12 @@ struct algorithm {
         const compare_type comp = heap->compare();
         const iterator first = heap->begin();
 
-        difference_type child = second_child_index(holeIndex);
+        difference_type child = first_child_index(holeIndex);
         while( child < size ) {
-            if( comp(*(first + child), *(first + child - 1)) )
-                --child;
-            heap->move_element(first, child, holeIndex);
-            holeIndex = child;
-            child = second_child_index(holeIndex);
-        }
-        if( child == size ) {
-            --child;
+            child = max_present_child(comp, first, holeIndex, child, size);
             heap->move_element(first, child, holeIndex);
             holeIndex = child;
+            child = first_child_index(holeIndex);
         }
 
         holeIndex = up_heap(heap, holeIndex, value, topIndex);
@@ -115,39 +547,37 @@ struct algorithm {
         const iterator first = heap->begin();
         const difference_type size = heap->end() - first;
 
-        difference_type secondChild = second_child_index(idx);
-        while( secondChild < size ) {
-            const difference_type firstChild = secondChild - 1;
-            difference_type maxIdx = idx;
-
-            if( comp(value, *(first + secondChild)) ) {
-                if( comp(*(first + secondChild), *(first + firstChild)) )
-                    maxIdx = firstChild;
-                else
-                    maxIdx = secondChild;
-            } else if( comp(value, *(first + firstChild)) ) {
-                maxIdx = firstChild;
-            }
+        difference_type child = first_child_index(idx);
+        while( child < size ) {
+            child = max_present_child(comp, first, idx, child, size);
 
-            if( maxIdx == idx ) {
-                heap->insert_element(first, idx, std::forward<T>(value));
-                return;
-            }
+            if( ! comp(value, *(first + child)) )
+                break;
 
-            heap->move_element(first, maxIdx, idx);
-            idx = maxIdx;
-            secondChild = second_child_index(idx);
-        }
-        if( secondChild == size ) {
-            const difference_type firstChild = secondChild - 1;
-            if( comp(value, *(first + firstChild)) ) {
-                heap->move_element(first, firstChild, idx);
-                idx = firstChild;
-            }
+            heap->move_element(first, child, idx);
+            idx = child;
+            child = first_child_index(idx);
         }
         heap->insert_element(first, idx, std::forward<T>(value));
     }
 
+    /// Bottom-up (Floyd/Wegener) variant of heapify: the hole at idx is first
+    /// moved down to a leaf along the path of the greatest children, then value
+    /// is sifted up again, but not above idx.
+    /// This needs arity - 1 instead of arity comparisons per level on the way
+    /// down and is therefore cheaper whenever value is expected to sink deep,
+    /// which is the common case when replacing the top element or building a
+    /// heap from scratch. heapify is preferable if value usually stays close
+    /// to idx.
+    template< typename T >
+    static void heapify_bottom_up(Heap *heap,
+                                  difference_type idx,
+                                  T&& value)
+    {
+        const difference_type size = heap->end() - heap->begin();
+        adjust_heap(heap, idx, std::forward<T>(value), size, idx);
+    }
+
     // Higher level operations using the basic algorithms
 
     template< typename T >
@@ -198,19 +628,215 @@ struct algorithm {
         const iterator first = heap->begin();
         const difference_type size = heap->end() - first;
 
-        for( auto i = (size / 2) - 1; i >= 0; --i ) {
-            heap->remove_element(first, i, *(first + i));
-            value_type value = std::move(*(first + i));
-            heapify(heap, i, value);
+        for( auto i = (first_leaf(heap) - first) - 1; i >= 0; --i ) {
+            if( first_child_index(i) >= size )
+                continue;
+            sift_down(heap, first, i);
+        }
+    }
+
+    /// make_heap using up to threads threads: the subtrees below a level
+    /// with enough nodes to balance the load are independent and heapified
+    /// concurrently, then the levels above are done serially.
+    /// The position tracker sees the same calls as with make_heap, but from
+    /// several threads at once (for different elements and positions).
+    /// Small heaps and layouts other than d_ary_layout are built serially.
+    static void make_heap_parallel(Heap *heap, unsigned threads)
+    {
+        const iterator first = heap->begin();
+        const difference_type size = heap->end() - first;
+        const difference_type lastParent = Layout::last_parent_index(size);
+
+        threads = unsigned(std::min<difference_type>(threads, size / difference_type(min_parallel_size)));
+        if( threads < 2 || ! std::is_same<Layout, d_ary_layout<Arity> >::value ) {
+            make_heap(heap);
+            return;
+        }
+
+        // Split level: nodes levelBegin ... levelEnd - 1
+        difference_type levelBegin = 0;
+        difference_type levelSize = 1;
+        while( levelSize < 4 * difference_type(threads) && first_child_index(levelBegin) <= lastParent ) {
+            levelBegin = first_child_index(levelBegin);
+            levelSize *= arity;
+        }
+        const difference_type levelEnd = std::min(levelBegin + levelSize, lastParent + 1);
+
+        std::vector<std::thread> workers;
+        const difference_type chunk = (levelEnd - levelBegin + threads - 1) / threads;
+        for( difference_type lo = levelBegin; lo < levelEnd; lo += chunk ) {
+            const difference_type hi = std::min(lo + chunk, levelEnd) - 1;
+            workers.emplace_back([heap, lo, hi] () { make_subtree_heaps(heap, lo, hi); });
+        }
+        for( auto &worker : workers )
+            worker.join();
+
+        for( difference_type i = levelBegin - 1; i >= 0; --i )
+            sift_down(heap, first, i);
+    }
+
+    /// make_heap_parallel uses at most one thread per this many elements.
+    static constexpr std::size_t min_parallel_size = 1 << 16;
+
+    /// Heapifies the subtrees rooted at the nodes lo ... hi of one level,
+    /// level by level from the bottom; only valid for d_ary_layout, where the
+    /// descendants of a range of nodes at each level form a range again.
+    static void make_subtree_heaps(Heap *heap, difference_type lo, difference_type hi)
+    {
+        const iterator first = heap->begin();
+        const difference_type lastParent = Layout::last_parent_index(heap->end() - first);
+
+        std::vector<std::pair<difference_type, difference_type> > levels;
+        while( lo <= lastParent ) {
+            levels.emplace_back(lo, std::min(hi, lastParent));
+            lo = first_child_index(lo);
+            hi = last_child_index(hi);
+        }
+
+        for( auto level = levels.crbegin(); level != levels.crend(); ++level ) {
+            for( difference_type i = level->second; i >= level->first; --i )
+                sift_down(heap, first, i);
+        }
+    }
+
+    /// Restores the heap property after the elements from index from on have
+    /// been appended to a valid heap of size from.
+    /// Unless the new elements outnumber the old ones by rebuild_ratio, they
+    /// are sifted up one by one like in push: for random values a push takes
+    /// O(1) steps on average, and the sift paths share the cached top levels,
+    /// which beats a rebuild in measurements even for k = n new elements.
+    /// Otherwise only the subtrees containing new elements are rebuilt
+    /// bottom-up, level by level, in O(k + log^2 n). The partial rebuild
+    /// relies on the ancestors of a range of nodes forming a range again, so
+    /// other layouts fall back to make_heap.
+    static void heapify_appended(Heap *heap, const difference_type from)
+    {
+        const iterator first = heap->begin();
+        const difference_type size = heap->end() - first;
+        const difference_type count = size - from;
+
+        if( count <= 0 )
+            return;
+
+        if( count < difference_type(rebuild_ratio) * from ) {
+            for( difference_type i = from; i < size; ++i ) {
+                heap->remove_element(first, i, *(first + i));
+                value_type value = std::move(*(first + i));
+                const difference_type pos = up_heap(heap, i, value);
+                heap->insert_element(first, pos, std::move(value));
+            }
+            return;
+        }
+
+        if( ! std::is_same<Layout, d_ary_layout<Arity> >::value || from < 2 ) {
+            make_heap(heap);
+            return;
+        }
+
+        difference_type lo = parent_index(from);
+        difference_type hi = parent_index(size - 1);
+        for( ;; ) {
+            for( difference_type i = hi; i >= lo; --i )
+                sift_down(heap, first, i);
+
+            if( lo == 0 )
+                break;
+
+            // nodes from lo on are already done
+            hi = std::min(parent_index(hi), lo - 1);
+            lo = parent_index(lo);
+        }
+    }
+
+    /// heapify_appended rebuilds instead of sifting up new elements if there
+    /// are at least this many times more of them than old ones.
+    static constexpr std::size_t rebuild_ratio = 8;
+
+    /// Re-sifts the element at idx, whose child subtrees are valid heaps.
+    static void sift_down(Heap *heap, const iterator first, const difference_type idx)
+    {
+        heap->remove_element(first, idx, *(first + idx));
+        value_type value = std::move(*(first + idx));
+        heapify_bottom_up(heap, idx, std::move(value));
+    }
+
+    /// Restores the heap property after the elements at the given positions
+    /// (duplicates allowed) were changed in place.
+    /// The dirty nodes are re-sifted top-down in descending index order, so
+    /// the child subtrees of each node are valid heaps by the time it is
+    /// processed. A node that ends up greater than its parent queues the
+    /// parent as well, which carries increased values up. If the dirty nodes
+    /// times the depth exceed the heap size, the heap is rebuilt with
+    /// make_heap instead. dirty is used as scratch space.
+    static void repair(Heap *heap, std::vector<difference_type>& dirty)
+    {
+        const iterator first = heap->begin();
+        const difference_type size = heap->end() - first;
+
+        if( dirty.empty() )
+            return;
+
+        difference_type depth = 1;
+        for( difference_type i = size - 1; i > 0; i = parent_index(i) )
+            ++depth;
+        if( difference_type(dirty.size()) * depth >= size ) {
+            make_heap(heap);
+            return;
+        }
+
+        const compare_type comp = heap->compare();
+
+        // The dirty indices are processed in descending order, merged with a
+        // max-heap of queued parents (usually much fewer)
+        std::sort(dirty.begin(), dirty.end(), std::greater<difference_type>());
+        std::vector<difference_type> parents;
+        auto next = dirty.cbegin();
+        difference_type last = -1;
+        while( next != dirty.cend() || ! parents.empty() ) {
+            difference_type idx;
+            if( parents.empty() || (next != dirty.cend() && *next >= parents.front()) ) {
+                idx = *next++;
+            } else {
+                std::pop_heap(parents.begin(), parents.end());
+                idx = parents.back();
+                parents.pop_back();
+            }
+
+            if( idx == last )
+                continue;
+            last = idx;
+
+            if( first_child_index(idx) < size ) {
+                heap->remove_element(first, idx, *(first + idx));
+                value_type value = std::move(*(first + idx));
+                heapify(heap, idx, std::move(value));
+            }
+
+            if( idx > 0 && comp(*(first + parent_index(idx)), *(first + idx)) ) {
+                parents.push_back(parent_index(idx));
+                std::push_heap(parents.begin(), parents.end());
+            }
         }
     }
 };
 
+template< class Heap, std::size_t Arity, class Layout >
+constexpr typename algorithm<Heap, Arity, Layout>::difference_type algorithm<Heap, Arity, Layout>::arity;
+template< class Heap, std::size_t Arity, class Layout >
+constexpr bool algorithm<Heap, Arity, Layout>::simd_children;
+template< class Heap, std::size_t Arity, class Layout >
+constexpr std::size_t algorithm<Heap, Arity, Layout>::min_parallel_size;
+template< class Heap, std::size_t Arity, class Layout >
+constexpr std::size_t algorithm<Heap, Arity, Layout>::rebuild_ratio;
+
 
 /// This hook in the heap class can be useful for debugging, algorithm visualisation
 /// and, most importantly, creating reverse lookup maps.
 /// The default no-op implementation does nothing and is hopefully optimized away by
 /// the compiler.
+/// The heap holds an instance of the tracker (see heap::position_tracker()),
+/// so trackers may also keep state, like the handle map of handle_heap;
+/// stateless trackers can simply use static functions.
 struct position_tracker_nop {
     template< typename Heap, typename T, typename DiffType >
     static void insert(const Heap& /*heap*/, const T& /*value*/, DiffType /*position*/) {}
@@ -224,46 +850,299 @@ struct position_tracker_nop {
 };
 
 
+/// Whether PositionTracker can locate an element of type T in the heap,
+/// i.e. provides position(value).
+template< class PositionTracker, typename T, typename = void >
+struct tracks_positions : std::false_type {};
+
+template< class PositionTracker, typename T >
+struct tracks_positions<PositionTracker, T,
+        decltype(std::declval<const PositionTracker&>().position(std::declval<const T&>()), void())>
+    : std::true_type {};
+
+
+/// Position tracker storing the heap position of each element in the member
+/// Member of the element itself, or of the pointee for pointer-like element
+/// types (anything with an operator* yielding Class&), e.g.
+/// intrusive_position_tracker<Node, int, &Node::heap_index>.
+/// Elements not in the heap (anymore) have the position npos.
+/// This allows heap::erase(const T&) and heap::update(const T&, U&&) to find
+/// the element without any search or side allocation.
+template< class Class, typename Index, Index Class::*Member >
+struct intrusive_position_tracker {
+    static constexpr Index npos = Index(-1);
+
+    template< typename Heap, typename T, typename DiffType >
+    static void insert(const Heap& /*heap*/, const T& value, DiffType position)
+    {
+        node(value).*Member = Index(position);
+    }
+
+    template< typename Heap, typename T, typename DiffType >
+    static void move(const Heap& /*heap*/, const T& value,
+                     DiffType /*oldPosition*/, DiffType newPosition)
+    {
+        node(value).*Member = Index(newPosition);
+    }
+
+    template< typename Heap, typename T, typename DiffType >
+    static void remove(const Heap& /*heap*/, const T& value, DiffType /*position*/)
+    {
+        node(value).*Member = npos;
+    }
+
+    template< typename T >
+    static std::ptrdiff_t position(const T& value) { return std::ptrdiff_t(node(value).*Member); }
+
+private:
+    // The tracker only gets const references, but the elements in the heap
+    // (or the pointees) are not actually const
+    static Class& node(const Class& value) { return const_cast<Class&>(value); }
+
+    template< typename Ptr >
+    static Class& node(const Ptr& ptr) { return const_cast<Class&>(static_cast<const Class&>(*ptr)); }
+};
+
+template< class Class, typename Index, Index Class::*Member >
+constexpr Index intrusive_position_tracker<Class, Index, Member>::npos;
+
+
+/// Allocator returning storage aligned to Alignment bytes (typically the
+/// cache line size). Alignment must be a power of two.
+template< typename T, std::size_t Alignment = 64 >
+struct aligned_allocator {
+    static_assert(Alignment >= alignof(void*) && (Alignment & (Alignment - 1)) == 0,
+                  "Alignment must be a power of two and at least pointer aligned");
+
+    typedef T value_type;
+
+    template< typename U >
+    struct rebind { typedef aligned_allocator<U, Alignment> other; };
+
+    aligned_allocator() = default;
+    template< typename U >
+    aligned_allocator(const aligned_allocator<U, Alignment>&) {}
+
+    T* allocate(std::size_t n)
+    {
+        // Over-allocate and store the original pointer right before the
+        // aligned block
+        const std::size_t extra = Alignment + sizeof(void*);
+        char *raw = static_cast<char*>(::operator new(n * sizeof(T) + extra));
+        const std::uintptr_t aligned = (reinterpret_cast<std::uintptr_t>(raw) + extra)
+                                       & ~std::uintptr_t(Alignment - 1);
+        reinterpret_cast<void**>(aligned)[-1] = raw;
+        return reinterpret_cast<T*>(aligned);
+    }
+
+    void deallocate(T *p, std::size_t)
+    {
+        ::operator delete(reinterpret_cast<void**>(p)[-1]);
+    }
+};
+
+template< typename T, typename U, std::size_t Alignment >
+bool operator==(const aligned_allocator<T, Alignment>&, const aligned_allocator<U, Alignment>&) { return true; }
+
+template< typename T, typename U, std::size_t Alignment >
+bool operator!=(const aligned_allocator<T, Alignment>&, const aligned_allocator<U, Alignment>&) { return false; }
+
+
+/// Heap container with a cache line aligned backing array, where the root
+/// is preceded by Arity - 1 unused slots. With the algorithm index math this
+/// puts every group of siblings at an array offset that is a multiple of
+/// Arity, so a sibling group starts on a line boundary whenever
+/// Arity * sizeof(T) is a multiple of LineSize, and never straddles a line
+/// boundary whenever it is a divisor of LineSize. Each level of a sift-down
+/// then touches exactly one (resp. the minimal number of) cache line(s).
+/// The unused slots are default constructed; they are only allocated with
+/// the first element, so empty (and moved-from) containers own no memory.
+/// Apart from that it behaves like the std::vector subset heap relies on.
+template< typename T, std::size_t Arity = 2, std::size_t LineSize = 64 >
+class cache_aligned_vector {
+    typedef std::vector<T, aligned_allocator<T, LineSize>> storage_type;
+
+public:
+    typedef T                                               value_type;
+    typedef typename storage_type::allocator_type           allocator_type;
+    typedef T*                                              iterator;
+    typedef const T*                                        const_iterator;
+    typedef typename storage_type::reference                reference;
+    typedef typename storage_type::const_reference          const_reference;
+    typedef typename storage_type::size_type                size_type;
+    typedef typename storage_type::difference_type          difference_type;
+
+    static constexpr size_type padding = Arity - 1;
+
+    cache_aligned_vector() = default;
+    explicit cache_aligned_vector(const allocator_type& alloc) : c(alloc) {}
+    cache_aligned_vector(std::initializer_list<T> il, const allocator_type& alloc = {})
+        : c(alloc) { assign(il.begin(), il.end()); }
+
+    cache_aligned_vector(const cache_aligned_vector& other) = default;
+    cache_aligned_vector(cache_aligned_vector&& other) = default;
+    cache_aligned_vector(const cache_aligned_vector& other, const allocator_type& alloc)
+        : c(other.c, alloc) {}
+    cache_aligned_vector(cache_aligned_vector&& other, const allocator_type& alloc)
+        : c(std::move(other.c), alloc) {}
+
+    cache_aligned_vector& operator=(const cache_aligned_vector& other) = default;
+    cache_aligned_vector& operator=(cache_aligned_vector&& other) = default;
+    cache_aligned_vector& operator=(std::initializer_list<T> il)
+    {
+        assign(il.begin(), il.end());
+        return *this;
+    }
+
+    template< typename InputIt >
+    void assign(InputIt first, InputIt last)
+    {
+        c.clear();
+        if( first != last ) {
+            c.resize(padding);
+            c.insert(c.end(), first, last);
+        }
+    }
+
+    iterator begin() { return c.data() + offset(); }
+    iterator end() { return c.data() + c.size(); }
+    const_iterator begin() const { return cbegin(); }
+    const_iterator end() const { return cend(); }
+    const_iterator cbegin() const { return c.data() + offset(); }
+    const_iterator cend() const { return c.data() + c.size(); }
+
+    bool empty() const { return c.size() <= padding; }
+    size_type size() const { return c.size() - offset(); }
+
+    reference operator[] ( size_type n ) { return c[n + padding]; }
+    const_reference operator[] ( size_type n ) const { return c[n + padding]; }
+    reference at( size_type n ) { return c.at(n + offset()); }
+    const_reference at( size_type n ) const { return c.at(n + offset()); }
+    reference front() { return c[padding]; }
+    const_reference front() const { return c[padding]; }
+    reference back() { return c.back(); }
+    const_reference back() const { return c.back(); }
+
+    void push_back(const T& value) { pad(); c.push_back(value); }
+    void push_back(T&& value) { pad(); c.push_back(std::move(value)); }
+    void pop_back() { c.pop_back(); }
+
+    void clear() noexcept { c.clear(); }
+
+    size_type capacity() const noexcept { return c.capacity() > padding ? c.capacity() - padding : 0; }
+    void reserve(size_type n) { c.reserve(n + padding); }
+    void shrink_to_fit() { c.shrink_to_fit(); }
+
+    allocator_type get_allocator() const { return c.get_allocator(); }
+
+    friend bool operator==(const cache_aligned_vector& lhs, const cache_aligned_vector& rhs)
+    {
+        return lhs.size() == rhs.size() && std::equal(lhs.begin(), lhs.end(), rhs.begin());
+    }
+
+    friend bool operator!=(const cache_aligned_vector& lhs, const cache_aligned_vector& rhs)
+    {
+        return !(lhs == rhs);
+    }
+
+private:
+    size_type offset() const { return c.empty() ? 0 : padding; }
+
+    void pad()
+    {
+        if( c.empty() )
+            c.resize(padding);
+    }
+
+    storage_type c;
+};
+
+template< typename T, std::size_t Arity, std::size_t LineSize >
+constexpr typename cache_aligned_vector<T, Arity, LineSize>::size_type cache_aligned_vector<T, Arity, LineSize>::padding;
+
+
+/// Thread count for building a heap from a container in parallel (see
+/// algorithm::make_heap_parallel); 0 selects the hardware concurrency.
+struct build_threads {
+    explicit build_threads(unsigned count = 0)
+        : count(count > 0 ? count : std::max(1u, std::thread::hardware_concurrency())) {}
+
+    unsigned count;
+};
+
+/// Tag for constructing a heap from a container that already is a valid
+/// heap for the comparator, e.g. a reopened mapped_vector; the container is
+/// taken over as it is, without make_heap.
+struct assume_heap_t {
+    explicit assume_heap_t() = default;
+};
+constexpr assume_heap_t assume_heap{};
+
+
 /// Default heap implementation using std::vector.
+/// Arity selects the number of children per node (see algorithm).
+/// Container may replace the std::vector storage with another random access
+/// container providing the std::vector subset used below, for example
+/// cache_aligned_vector.
+/// Layout selects the index math (see d_ary_layout and b_heap_layout).
 template< typename T,
           class Compare = std::less<T>,
           class PositionTracker = position_tracker_nop,
-          class Alloc = std::allocator<T> >
+          class Alloc = std::allocator<T>,
+          std::size_t Arity = 2,
+          class Container = std::vector<T, Alloc>,
+          class Layout = d_ary_layout<Arity> >
 class heap {
-    friend struct algorithm<heap<T, Compare, PositionTracker, Alloc>>;
-    typedef algorithm<heap<T, Compare, PositionTracker, Alloc>> alg;
+    friend struct algorithm<heap, Arity, Layout>;
+    typedef algorithm<heap, Arity, Layout> alg;
+
+    static_assert(std::is_same<T, typename Container::value_type>::value,
+                  "Container::value_type must be T");
 
 public:
     typedef T                                               value_type;
-    typedef std::vector<T, Alloc>                           container_type;
+    typedef Container                                       container_type;
     typedef typename container_type::const_iterator         const_iterator;
     typedef typename container_type::const_reference        const_reference;
     typedef typename container_type::size_type              size_type;
     typedef typename container_type::difference_type        difference_type;
     typedef Compare                                         compare_type;
     typedef typename container_type::allocator_type         allocator_type;
+    typedef Layout                                          layout_type;
+
+    static constexpr std::size_t arity = Arity;
 
     heap() = default;
 
     explicit heap(const container_type& ctnr, const Compare& comp = {})
-        : d(ctnr, comp) { alg::make_heap(this); }
+        : d(ctnr, comp) { build(); }
     explicit heap(container_type&& ctnr, const Compare& comp = {})
-        : d(std::move(ctnr), comp) { alg::make_heap(this); }
+        : d(std::move(ctnr), comp) { build(); }
     heap(std::initializer_list<value_type> il)
-        : d(il) { alg::make_heap(this); }
+        : d(il) { build(); }
+
+    heap(const container_type& ctnr, build_threads threads, const Compare& comp = {})
+        : d(ctnr, comp) { build(threads.count); }
+    heap(container_type&& ctnr, build_threads threads, const Compare& comp = {})
+        : d(std::move(ctnr), comp) { build(threads.count); }
+
+    heap(const container_type& ctnr, assume_heap_t, const Compare& comp = {})
+        : d(ctnr, comp) { track_all(); }
+    heap(container_type&& ctnr, assume_heap_t, const Compare& comp = {})
+        : d(std::move(ctnr), comp) { track_all(); }
 
     heap(const heap& other) = default;
     heap(heap&& other) = default;
 
     heap(const container_type& ctnr, const allocator_type& alloc, const Compare& comp = {})
-        : d(ctnr, comp, alloc) { alg::make_heap(this); }
+        : d(ctnr, comp, alloc) { build(); }
     heap(container_type&& ctnr, const allocator_type& alloc, const Compare& comp = {})
-        : d(std::move(ctnr), comp, alloc) { alg::make_heap(this); }
+        : d(std::move(ctnr), comp, alloc) { build(); }
 
     heap(const heap& other, const allocator_type& alloc)
-        : d(other.d.c, other.d, alloc) {}
+        : d(other.d.c, other.d, alloc, other.d) {}
     heap(heap&& other, const allocator_type& alloc)
-        : d(std::move(other.d.c), other.d, alloc) {}
+        : d(std::move(other.d.c), other.d, alloc, other.d) {}
 
 
     heap& operator=(const heap& other) = default;
@@ -271,7 +1150,7 @@ public:
     heap& operator=(std::initializer_list<value_type> il)
     {
         d.c = il;
-        alg::make_heap(this);
+        build();
         return *this;
     }
 
@@ -280,7 +1159,11 @@ public:
 
     bool empty() const { return d.c.empty(); }
     size_t size() const { return d.c.size(); }
-    const T& top() const { return d.c.front(); }
+    const T& top() const
+    {
+        assert(! batchPending && "use update_batch::top() while a batch has uncommitted changes");
+        return d.c.front();
+    }
 
     template< typename U >
     void push(U&& value) { alg::push(this, std::forward<U>(value)); }
@@ -290,6 +1173,160 @@ public:
 
     // Additional API
 
+    /// Pushes all elements of [first, last); use move iterators to move them.
+    /// Depending on their number compared to size(), the new elements are
+    /// either sifted up one by one or the affected part of the heap is
+    /// rebuilt (see algorithm::heapify_appended).
+    template< typename InputIterator >
+    void push_range(InputIterator first, InputIterator last)
+    {
+        reserve_range(first, last, typename std::iterator_traits<InputIterator>::iterator_category());
+
+        const difference_type from = d.c.size();
+        for( difference_type i = from; first != last; ++first, ++i ) {
+            d.c.push_back(*first);
+            position_tracker().insert(*this, d.c.back(), i);
+        }
+        alg::heapify_appended(this, from);
+    }
+
+    /// Moves all elements of other into this heap, leaving other empty.
+    /// other has to be ordered by an equivalent compare. If other is the
+    /// larger heap and the allocators compare equal, its storage (which
+    /// already is a valid heap) is taken over and the elements of this heap
+    /// are added to it instead. Insertion uses push_range, so it picks
+    /// between sifting up and rebuilding depending on the relative sizes.
+    /// The tracker of other is notified about the removal of its elements,
+    /// the tracker of this heap about every (re)insertion.
+    void merge(heap&& other)
+    {
+        if( &other == this || other.empty() )
+            return;
+
+        for( difference_type i = 0, n = other.d.c.size(); i < n; ++i )
+            other.position_tracker().remove(other, other.d.c[i], i);
+
+        if( size() < other.size() && get_allocator() == other.get_allocator() ) {
+            using std::swap;
+            swap(d.c, other.d.c);
+            for( difference_type i = 0, n = d.c.size(); i < n; ++i )
+                position_tracker().insert(*this, d.c[i], i);
+            for( difference_type i = 0, n = other.d.c.size(); i < n; ++i )
+                position_tracker().remove(*this, other.d.c[i], i);
+        }
+
+        push_range(std::make_move_iterator(other.d.c.begin()), std::make_move_iterator(other.d.c.end()));
+        other.d.c.clear();
+    }
+
+    /// Changes many elements in place and repairs the heap only once, on
+    /// commit() or destruction (see algorithm::repair). No other function
+    /// of the heap may be used while a batch has uncommitted changes; use
+    /// update_batch::top() to read the top element, which commits first
+    /// (heap::top() asserts this in debug builds). The destructor does not
+    /// throw: if the repair fails (allocation or compare), it falls back to
+    /// rebuilding the heap, and if that fails too, the heap is left
+    /// unordered. Call commit() to see such errors.
+    /// Note that the repair visits every changed element a second time, so
+    /// for heaps beyond the cache it is measurably slower than calling
+    /// update/increase/decrease directly (whose sift works on the cache line
+    /// just loaded); measure before switching.
+    class update_batch {
+    public:
+        explicit update_batch(heap& h) : h(h) {}
+        update_batch(const update_batch&) = delete;
+        update_batch& operator=(const update_batch&) = delete;
+        ~update_batch()
+        {
+            try {
+                commit();
+            } catch( ... ) {
+                dirty.clear();
+                h.mark_batch_pending(false);
+                try {
+                    alg::make_heap(&h);
+                } catch( ... ) {}
+            }
+        }
+
+        template< typename U >
+        void update(const_iterator position, U&& newValue)
+        {
+            const iterator first = h.begin();
+            const difference_type p = position - first;
+
+            h.remove_element(first, p, *position);
+            h.insert_element(first, p, std::forward<U>(newValue));
+            dirty.push_back(p);
+            h.mark_batch_pending(true);
+        }
+
+        const T& top()
+        {
+            commit();
+            return h.top();
+        }
+
+        void commit()
+        {
+            alg::repair(&h, dirty);
+            dirty.clear();
+            h.mark_batch_pending(false);
+        }
+
+    private:
+        heap& h;
+        std::vector<difference_type> dirty;
+    };
+
+    /// Erases all elements for which pred returns true and returns their
+    /// number; pred is called exactly once per element. The remaining
+    /// elements are compacted in one pass, which leaves the elements before
+    /// the first erased position a valid heap. The m survivors behind it are
+    /// then restored like appended elements (see algorithm::heapify_appended):
+    /// sifted up one by one, O(m log n) in the worst case and O(m) on average
+    /// for random values, or rebuilt in O(m + log^2 n) once they outnumber
+    /// the prefix by rebuild_ratio.
+    template< typename Predicate >
+    size_type erase_if(Predicate pred)
+    {
+        const iterator first = begin();
+        const difference_type size = end() - first;
+
+        difference_type write = 0;
+        while( write < size && ! pred(*(first + write)) )
+            ++write;
+
+        const difference_type firstErased = write;
+        if( write < size )
+            remove_element(first, write, *(first + write));
+        for( difference_type i = write + 1; i < size; ++i ) {
+            if( pred(*(first + i)) ) {
+                remove_element(first, i, *(first + i));
+            } else {
+                move_element(first, i, write);
+                ++write;
+            }
+        }
+
+        for( difference_type i = write; i < size; ++i )
+            pop_back();
+
+        alg::heapify_appended(this, firstErased);
+        return size_type(size - write);
+    }
+
+    /// Copies all elements of other into this heap (see merge(heap&&)).
+    void merge(const heap& other)
+    {
+        if( &other == this ) {
+            const container_type copy = d.c;
+            push_range(copy.begin(), copy.end());
+            return;
+        }
+        push_range(other.cbegin(), other.cend());
+    }
+
     T pop_top() { return take(begin()); }
 
     void erase(const_iterator position)
@@ -318,6 +1355,21 @@ public:
         update_value(position, std::forward<U>(newValue));
     }
 
+    // Overloads locating the element through the position tracker; only
+    // available if it provides position(value), like intrusive_position_tracker.
+    // value must be in the heap.
+
+    template< typename V, typename = typename std::enable_if<
+                  std::is_same<V, T>::value && tracks_positions<PositionTracker, V>::value>::type >
+    void erase(const V& value) { erase(cbegin() + position_tracker().position(value)); }
+
+    template< typename V, typename U, typename = typename std::enable_if<
+                  std::is_same<V, T>::value && tracks_positions<PositionTracker, V>::value>::type >
+    void update(const V& value, U&& newValue)
+    {
+        update_value(cbegin() + position_tracker().position(value), std::forward<U>(newValue));
+    }
+
     // If the user knows that the updated value has increased or decreased
     // compared to before, a usually more efficient algorithm can be used
 
@@ -333,12 +1385,72 @@ public:
     /// Like update, but assumes newValue has not increased (w.r.t. compare()
     /// and the old value at position).
     /// Behavior is undefined when this precondition does not hold.
+    /// Uses the bottom-up sift (see algorithm::heapify_bottom_up), as a
+    /// decreased value typically sinks deep into the heap.
     template< typename U >
     void decrease(const_iterator position, U&& newValue)
     {
         decrease_value(position, std::forward<U>(newValue));
     }
 
+    // Batch operations on the top element(s)
+
+    /// Pops the top element and pushes value with a single sift, which stops
+    /// as soon as value is not less than the greatest child (i.e. immediately
+    /// if value becomes the new top). The heap must not be empty.
+    template< typename U >
+    void replace_top(U&& value)
+    {
+        const iterator first = begin();
+        remove_element(first, 0, *first);
+        alg::heapify(this, 0, std::forward<U>(value));
+    }
+
+    /// Pushes value and pops the top element, returning it. If value would
+    /// be the new top, it is returned right away without touching the heap.
+    template< typename U >
+    T push_pop(U&& value)
+    {
+        if( empty() || ! compare()(value, top()) )
+            return T(std::forward<U>(value));
+
+        const iterator first = begin();
+        T result = std::move(*first);
+        remove_element(first, 0, result);
+        alg::heapify(this, 0, std::forward<U>(value));
+        return result;
+    }
+
+    /// Pops all elements from the top for which pred returns true, writing
+    /// them in pop order to out. Returns the output iterator past the last
+    /// written element.
+    template< typename Predicate, typename OutputIterator >
+    OutputIterator drain_while(Predicate pred, OutputIterator out)
+    {
+        while( ! empty() && pred(top()) )
+            *out++ = pop_top();
+        return out;
+    }
+
+    /// As long as pred returns true for the top element, modifies it in place
+    /// by calling fn on it and restores the heap (like a timer queue firing
+    /// and rescheduling all due timers). fn has to make pred false eventually.
+    /// Returns the number of fn calls.
+    template< typename Predicate, typename Function >
+    size_type reschedule_while(Predicate pred, Function fn)
+    {
+        size_type count = 0;
+        while( ! empty() && pred(top()) ) {
+            const iterator first = begin();
+            T value = std::move(*first);
+            remove_element(first, 0, value);
+            fn(value);
+            alg::heapify_bottom_up(this, 0, std::move(value));
+            ++count;
+        }
+        return count;
+    }
+
     const_iterator begin() const { return cbegin(); }
     const_iterator end() const { return cend(); }
     const_iterator cbegin() const { return d.c.cbegin(); }
@@ -355,6 +1467,9 @@ public:
     void reserve(size_type n) { d.c.reserve(n); }
     void shrink_to_fit() { d.c.shrink_to_fit(); }
 
+    const PositionTracker& position_tracker() const { return d; }
+    PositionTracker& position_tracker() { return d; }
+
     Compare compare() const { return d; }
     void set_compare(const Compare &compare)
     {
@@ -370,7 +1485,7 @@ public:
         return tmp;
     }
 
-    Alloc get_allocator() const { return d.c.get_allocator(); }
+    allocator_type get_allocator() const { return d.c.get_allocator(); }
 
 private:
     // API needed by algorithm (besides compare() which is public)
@@ -384,22 +1499,50 @@ private:
     void pop_back() { d.c.pop_back(); }
     T &back() { return d.c.back(); }
 
+    // Reports the elements of a new container to the position tracker and
+    // establishes the heap property
+    void build(unsigned threads = 1)
+    {
+        track_all();
+        alg::make_heap_parallel(this, threads);
+    }
+
+    void track_all()
+    {
+        const iterator first = begin();
+        for( difference_type i = 0, n = end() - first; i < n; ++i )
+            position_tracker().insert(*this, *(first + i), i);
+    }
+
+    template< typename InputIterator >
+    void reserve_range(InputIterator, InputIterator, std::input_iterator_tag) {}
+
+    template< typename ForwardIterator >
+    void reserve_range(ForwardIterator first, ForwardIterator last, std::forward_iterator_tag)
+    {
+        const size_type needed = d.c.size() + std::distance(first, last);
+        if( needed > d.c.capacity() )
+            d.c.reserve(std::max(needed, 2 * d.c.capacity()));
+    }
+
+    void mark_batch_pending(bool pending) { batchPending = pending; }
+
     void remove_element(iterator, difference_type idx, const T& value)
     {
-        PositionTracker::template remove(*this, value, idx);
+        position_tracker().remove(*this, value, idx);
     }
 
     void move_element(iterator first, difference_type from, difference_type to)
     {
         *(first + to) = std::move(*(first + from));
-        PositionTracker::template move(*this, *(first + to), from, to);
+        position_tracker().move(*this, *(first + to), from, to);
     }
 
     template< typename U >
     void insert_element(iterator first, difference_type to, U&& value)
     {
         *(first + to) = std::forward<U>(value);
-        PositionTracker::template insert(*this, *(first + to), to);
+        position_tracker().insert(*this, *(first + to), to);
     }
 
     // Specialized algorithm for improved performance
@@ -432,12 +1575,12 @@ private:
         const difference_type p = position - first;
 
         remove_element(first, p, *position);
-        alg::heapify(this, p, std::forward<U>(newValue));
+        alg::heapify_bottom_up(this, p, std::forward<U>(newValue));
     }
 
     // Data member
 
-    struct Data : public Compare {
+    struct Data : public Compare, public PositionTracker {
         Data() = default;
 
         template< typename S >
@@ -446,8 +1589,9 @@ private:
         {}
 
         template< typename S >
-        Data(S&& container, const Compare& comp, const Alloc& alloc)
-            : Compare(comp), c(std::forward<S>(container), alloc)
+        Data(S&& container, const Compare& comp, const allocator_type& alloc,
+             const PositionTracker& tracker = {})
+            : Compare(comp), PositionTracker(tracker), c(std::forward<S>(container), alloc)
         {}
 
         Data(std::initializer_list<value_type> il)
@@ -458,8 +1602,33 @@ private:
     };
 
     Data d;
+    // an update_batch has uncommitted changes; kept in release builds too,
+    // so that the layout does not depend on NDEBUG
+    bool batchPending = false;
 };
 
+template< typename T, class Compare, class PositionTracker, class Alloc, std::size_t Arity, class Container, class Layout >
+constexpr std::size_t heap<T, Compare, PositionTracker, Alloc, Arity, Container, Layout>::arity;
+
+
+/// Heap using a cache_aligned_vector as storage.
+template< typename T,
+          class Compare = std::less<T>,
+          class PositionTracker = position_tracker_nop,
+          std::size_t Arity = 2,
+          std::size_t LineSize = 64 >
+using cache_aligned_heap = heap<T, Compare, PositionTracker, aligned_allocator<T, LineSize>, Arity,
+                                cache_aligned_vector<T, Arity, LineSize>>;
+
+/// Binary heap in b_heap_layout, with blocks of (at most) PageSize bytes.
+template< typename T,
+          class Compare = std::less<T>,
+          class PositionTracker = position_tracker_nop,
+          std::size_t PageSize = 4096,
+          class Alloc = std::allocator<T> >
+using b_heap = heap<T, Compare, PositionTracker, Alloc, 2, std::vector<T, Alloc>,
+                    b_heap_layout<2, complete_tree_height(PageSize / sizeof(T), 2)>>;
+
 
 } // namespace binary_max_heap
 
@@ -0,0 +1,134 @@
+/* Copyright 2015 Zeno Sebastian Endemann <zeno.endemann@googlemail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the licence, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BINARY_MAX_HEAP_BUFFERED_HEAP_H
+#define BINARY_MAX_HEAP_BUFFERED_HEAP_H
+
+#include "binary_heap.h"
+
+#include <iterator>
+#include <vector>
+
+namespace binary_max_heap {
+
+/// Heap with an insertion buffer in front, after the insertion buffer of
+/// Sanders' sequence heaps: pushed elements first go into an unordered buffer
+/// of at most BufferSize elements, which stays in the L1 cache, and whose
+/// greatest element is kept track of. When full, the buffer is moved into the
+/// main heap in one batch (heap::push_range). top() looks at both.
+/// A push costs a single comparison until the buffer is flushed, and elements
+/// popped while still buffered never touch the main heap, which pays off when
+/// new elements tend to be the greater ones or pops are frequent. Popping
+/// from the buffer rescans it, so BufferSize should stay small.
+/// As elements move between buffer and heap, there is no position tracker.
+template< typename T,
+          class Compare = std::less<T>,
+          std::size_t BufferSize = 64,
+          std::size_t Arity = 2 >
+class buffered_heap {
+public:
+    typedef heap<T, Compare, position_tracker_nop, std::allocator<T>, Arity> heap_type;
+    typedef T                                               value_type;
+    typedef typename heap_type::size_type                   size_type;
+
+    static_assert(BufferSize > 0, "BufferSize must not be 0");
+
+    buffered_heap() { buffer.reserve(BufferSize); }
+    explicit buffered_heap(const Compare& comp)
+        : h(typename heap_type::container_type(), comp)
+    {
+        buffer.reserve(BufferSize);
+    }
+
+    bool empty() const { return h.empty() && buffer.empty(); }
+    size_type size() const { return h.size() + buffer.size(); }
+
+    const T& top() const { return top_in_buffer() ? buffer[best] : h.top(); }
+
+    template< typename U >
+    void push(U&& value)
+    {
+        if( buffer.size() == BufferSize )
+            flush();
+        buffer.push_back(std::forward<U>(value));
+        if( buffer.size() == 1 || h.compare()(buffer[best], buffer.back()) )
+            best = buffer.size() - 1;
+    }
+
+    template< typename... Args >
+    void emplace(Args&&... args)
+    {
+        push(T(std::forward<Args>(args)...));
+    }
+
+    void pop()
+    {
+        if( top_in_buffer() )
+            take_best();
+        else
+            h.pop();
+    }
+
+    T pop_top() { return top_in_buffer() ? take_best() : h.pop_top(); }
+
+    /// Moves the buffered elements into the main heap.
+    void flush()
+    {
+        h.push_range(std::make_move_iterator(buffer.begin()), std::make_move_iterator(buffer.end()));
+        buffer.clear();
+    }
+
+    void clear()
+    {
+        h.clear();
+        buffer.clear();
+    }
+
+    void reserve(size_type n) { h.reserve(n); }
+
+    Compare compare() const { return h.compare(); }
+
+private:
+    bool top_in_buffer() const
+    {
+        return ! buffer.empty() && (h.empty() || h.compare()(h.top(), buffer[best]));
+    }
+
+    T take_best()
+    {
+        T value = std::move(buffer[best]);
+        if( best + 1 != buffer.size() )
+            buffer[best] = std::move(buffer.back());
+        buffer.pop_back();
+
+        const Compare comp = h.compare();
+        best = 0;
+        for( size_type i = 1; i < buffer.size(); ++i ) {
+            if( comp(buffer[best], buffer[i]) )
+                best = i;
+        }
+        return value;
+    }
+
+    heap_type h;
+    std::vector<T> buffer;
+    size_type best = 0; // index of the greatest buffered element
+};
+
+} // namespace binary_max_heap
+
+#endif // BINARY_MAX_HEAP_BUFFERED_HEAP_H
@@ -0,0 +1,50 @@
+/* Copyright 2015 Zeno Sebastian Endemann <zeno.endemann@googlemail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the licence, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BINARY_MAX_HEAP_CHECKSUM_H
+#define BINARY_MAX_HEAP_CHECKSUM_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace binary_max_heap {
+
+namespace checksum_detail {
+
+// FNV-1a over 64 bit words, for the checksums of the files of mapped_vector
+// and journaled_heap
+inline std::uint64_t fnv1a(const void *data, std::size_t n)
+{
+    const unsigned char *p = static_cast<const unsigned char*>(data);
+    std::uint64_t hash = 14695981039346656037ull;
+    std::size_t i = 0;
+    for( ; i + 8 <= n; i += 8 ) {
+        std::uint64_t word;
+        std::memcpy(&word, p + i, 8);
+        hash = (hash ^ word) * 1099511628211ull;
+    }
+    for( ; i < n; ++i )
+        hash = (hash ^ p[i]) * 1099511628211ull;
+    return hash;
+}
+
+} // namespace checksum_detail
+
+} // namespace binary_max_heap
+
+#endif // BINARY_MAX_HEAP_CHECKSUM_H
@@ -0,0 +1,282 @@
+/* Copyright 2015 Zeno Sebastian Endemann <zeno.endemann@googlemail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the licence, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BINARY_MAX_HEAP_CONCURRENT_HEAP_H
+#define BINARY_MAX_HEAP_CONCURRENT_HEAP_H
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <thread>
+
+namespace binary_max_heap {
+
+/// Minimal test-and-test-and-set spin lock (yielding while contended).
+class spin_lock {
+public:
+    void lock()
+    {
+        while( locked.exchange(true, std::memory_order_acquire) ) {
+            while( locked.load(std::memory_order_relaxed) )
+                std::this_thread::yield();
+        }
+    }
+
+    bool try_lock()
+    {
+        return ! locked.load(std::memory_order_relaxed)
+                && ! locked.exchange(true, std::memory_order_acquire);
+    }
+
+    void unlock() { locked.store(false, std::memory_order_release); }
+
+private:
+    std::atomic<bool> locked{false};
+};
+
+
+/// Fixed capacity binary max heap for concurrent use, with one lock per node
+/// (Hunt, Michael, Parthasarathy, Scott: "An efficient algorithm for
+/// concurrent priority queue heaps", 1996).
+/// A global lock is only held to change the size. An insertion then sifts
+/// its element up bottom-up and a deletion sifts the former last element
+/// down from the root, both holding at most a parent and its children locked,
+/// so operations in different parts of the tree proceed in parallel.
+/// Each node is tagged as empty, available, or owned by the insertion still
+/// sifting it up; an inserter whose element was moved by a concurrent
+/// deletion follows it upwards. Successive insertions are placed in
+/// bit-reversed order along the bottom level, so that their sift paths
+/// diverge right below the root.
+/// Each operation takes several locks per level, so without contention this
+/// is considerably slower than a heap behind a single mutex; it only pays off
+/// with many threads on as many cores.
+/// There is no top(), as it could not be answered consistently without
+/// locking the root for the caller; use try_pop.
+template< typename T, class Compare = std::less<T> >
+class concurrent_heap {
+public:
+    typedef T                                               value_type;
+    typedef std::size_t                                     size_type;
+
+    explicit concurrent_heap(size_type capacity, const Compare& comp = {})
+        : comp(comp),
+          cap(capacity),
+          nodeCount(node_count(capacity)),
+          nodes(new node[nodeCount + 1]) // 1-based
+    {}
+
+    concurrent_heap(const concurrent_heap&) = delete;
+    concurrent_heap& operator=(const concurrent_heap&) = delete;
+
+    /// Returns false if the heap is full.
+    bool push(T value)
+    {
+        sizeLock.lock();
+        if( count == cap ) {
+            sizeLock.unlock();
+            return false;
+        }
+        size_type i = position(++count);
+        nodes[i].lock.lock();
+        sizeLock.unlock();
+
+        const std::uint64_t tag = nextTag.fetch_add(1, std::memory_order_relaxed);
+        nodes[i].value = std::move(value);
+        nodes[i].tag = tag;
+        nodes[i].lock.unlock();
+
+        while( i > 1 ) {
+            const size_type parent = i / 2;
+            const size_type old = i;
+            nodes[parent].lock.lock();
+            nodes[i].lock.lock();
+
+            if( nodes[parent].tag == available_tag && nodes[i].tag == tag ) {
+                if( comp(nodes[parent].value, nodes[i].value) ) {
+                    swap_nodes(parent, i);
+                    i = parent;
+                } else {
+                    nodes[i].tag = available_tag;
+                    i = 0;
+                }
+            } else if( nodes[parent].tag == empty_tag ) {
+                // our element was taken by a deletion
+                i = 0;
+            } else if( nodes[i].tag != tag ) {
+                // a deletion moved our element up
+                i = parent;
+            }
+            const bool retry = i == old;
+
+            nodes[old].lock.unlock();
+            nodes[parent].lock.unlock();
+
+            // the parent is still being inserted: let its inserter proceed
+            if( retry )
+                std::this_thread::yield();
+        }
+
+        if( i == 1 ) {
+            nodes[1].lock.lock();
+            if( nodes[1].tag == tag )
+                nodes[1].tag = available_tag;
+            nodes[1].lock.unlock();
+        }
+        return true;
+    }
+
+    /// Removes the greatest element into value; returns false if the heap is
+    /// empty.
+    bool try_pop(T& value)
+    {
+        sizeLock.lock();
+        if( count == 0 ) {
+            sizeLock.unlock();
+            return false;
+        }
+        const size_type bottom = position(count--);
+        nodes[bottom].lock.lock();
+        sizeLock.unlock();
+
+        T last = std::move(nodes[bottom].value);
+        nodes[bottom].tag = empty_tag;
+        nodes[bottom].lock.unlock();
+
+        nodes[1].lock.lock();
+        if( nodes[1].tag == empty_tag ) {
+            // last was the only element
+            nodes[1].lock.unlock();
+            value = std::move(last);
+            return true;
+        }
+
+        value = std::move(nodes[1].value);
+        nodes[1].value = std::move(last);
+        nodes[1].tag = available_tag;
+
+        size_type i = 1;
+        while( 2 * i <= nodeCount ) {
+            const size_type left = 2 * i;
+            const size_type right = left + 1;
+            nodes[left].lock.lock();
+            const bool hasRight = right <= nodeCount;
+            if( hasRight )
+                nodes[right].lock.lock();
+
+            size_type child;
+            if( nodes[left].tag == empty_tag ) {
+                // no children (the tree fills level by level)
+                if( hasRight )
+                    nodes[right].lock.unlock();
+                nodes[left].lock.unlock();
+                break;
+            } else if( hasRight && nodes[right].tag != empty_tag
+                       && comp(nodes[left].value, nodes[right].value) ) {
+                nodes[left].lock.unlock();
+                child = right;
+            } else {
+                if( hasRight )
+                    nodes[right].lock.unlock();
+                child = left;
+            }
+
+            if( comp(nodes[i].value, nodes[child].value) ) {
+                swap_nodes(i, child);
+                nodes[i].lock.unlock();
+                i = child;
+            } else {
+                nodes[child].lock.unlock();
+                break;
+            }
+        }
+        nodes[i].lock.unlock();
+        return true;
+    }
+
+    /// Number of elements; only a snapshot under concurrent modification.
+    size_type size() const
+    {
+        sizeLock.lock();
+        const size_type n = count;
+        sizeLock.unlock();
+        return n;
+    }
+
+    bool empty() const { return size() == 0; }
+    size_type capacity() const { return cap; }
+
+    Compare compare() const { return comp; }
+
+private:
+    enum : std::uint64_t {
+        empty_tag = 0,
+        available_tag = 1,
+        first_insert_tag = 2
+    };
+
+    struct node {
+        spin_lock lock;
+        std::uint64_t tag = empty_tag;
+        T value;
+    };
+
+    // Smallest complete tree (2^k - 1 nodes) holding capacity elements, as
+    // bit-reversed positions cover the whole bottom level
+    static size_type node_count(size_type capacity)
+    {
+        size_type n = 1;
+        while( n < capacity )
+            n = 2 * n + 1;
+        return n;
+    }
+
+    // Node of the n-th element (1-based): the n-th position in level order,
+    // with the position within its level bit-reversed
+    static size_type position(size_type n)
+    {
+        size_type level = 0;
+        while( (n >> (level + 1)) != 0 )
+            ++level;
+
+        const size_type offset = n - (size_type(1) << level);
+        size_type reversed = 0;
+        for( size_type b = 0; b < level; ++b )
+            reversed |= ((offset >> b) & 1) << (level - 1 - b);
+        return (size_type(1) << level) + reversed;
+    }
+
+    void swap_nodes(size_type a, size_type b)
+    {
+        using std::swap;
+        swap(nodes[a].value, nodes[b].value);
+        swap(nodes[a].tag, nodes[b].tag);
+    }
+
+    const Compare comp;
+    const size_type cap;
+    const size_type nodeCount;
+    std::unique_ptr<node[]> nodes;
+
+    mutable spin_lock sizeLock;
+    size_type count = 0;
+    std::atomic<std::uint64_t> nextTag{first_insert_tag};
+};
+
+} // namespace binary_max_heap
+
+#endif // BINARY_MAX_HEAP_CONCURRENT_HEAP_H
@@ -0,0 +1,307 @@
+/* Copyright 2015 Zeno Sebastian Endemann <zeno.endemann@googlemail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the licence, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BINARY_MAX_HEAP_EXTERNAL_HEAP_H
+#define BINARY_MAX_HEAP_EXTERNAL_HEAP_H
+
+#include "binary_heap.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+namespace binary_max_heap {
+
+/// Max priority queue for more elements than fit into memory, for trivially
+/// copyable T. Pushed elements go into an in-memory heap of half the memory
+/// budget. When it is full, its elements are popped in descending order into
+/// a sorted run, which is written to a temporary file (std::tmpfile) in large
+/// sequential blocks. Of each run only one block is kept in memory, and the
+/// run heads are merged with a second heap; top() is the greater of the two
+/// heap tops. The other half of the budget goes to these run blocks, sized
+/// for up to max_runs runs.
+/// Runs are merged by levels: a spilled run has level 0, and once there are
+/// merge_width runs of a level, they are merged into one run of the next
+/// level. Every element is thus rewritten once per level, O(log(N / M)) times
+/// for N elements and a budget of M. Only if max_runs runs are reached anyway
+/// all of them are merged into one.
+/// Throws std::runtime_error if a temporary file cannot be created, written
+/// or read.
+template< typename T, class Compare = std::less<T> >
+class external_heap {
+public:
+    typedef T                                               value_type;
+    typedef std::size_t                                     size_type;
+
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "external_heap elements are written to disk as raw bytes");
+
+    /// Maximum number of runs on disk before they are merged.
+    static constexpr size_type max_runs = 64;
+
+    /// Number of runs of one level that are merged into a run of the next.
+    static constexpr size_type merge_width = 8;
+
+    explicit external_heap(size_type memoryBudget, const Compare& comp = {})
+        : budget(memoryBudget),
+          heapCapacity(std::max<size_type>(1, memoryBudget / 2 / sizeof(T))),
+          blockSize(std::max<size_type>(1, memoryBudget / 2 / sizeof(T) / max_runs)),
+          h(typename heap_type::container_type(), comp),
+          heads(typename head_heap::container_type(), head_compare(comp))
+    {
+        h.reserve(heapCapacity);
+    }
+
+    external_heap(const external_heap&) = delete;
+    external_heap& operator=(const external_heap&) = delete;
+
+    bool empty() const { return count == 0; }
+    size_type size() const { return count; }
+
+    const T& top() const { return top_in_runs() ? heads.top().value : h.top(); }
+
+    void push(const T& value)
+    {
+        if( h.size() == heapCapacity )
+            spill();
+        h.push(value);
+        ++count;
+    }
+
+    void pop()
+    {
+        if( top_in_runs() )
+            advance_top_run();
+        else
+            h.pop();
+        --count;
+    }
+
+    T pop_top()
+    {
+        T value = top();
+        pop();
+        return value;
+    }
+
+    void clear()
+    {
+        h.clear();
+        heads.clear();
+        runs.clear();
+        count = 0;
+    }
+
+    size_type memory_budget() const { return budget; }
+
+    /// Number of runs on disk that still have elements.
+    size_type run_count() const { return heads.size(); }
+
+    Compare compare() const { return h.compare(); }
+
+private:
+    typedef heap<T, Compare> heap_type;
+
+    struct file_closer {
+        void operator()(std::FILE *f) const { std::fclose(f); }
+    };
+
+    struct run {
+        std::unique_ptr<std::FILE, file_closer> file;
+        std::vector<T> block;
+        size_type next = 0;
+        size_type level = 0;
+    };
+
+    struct head {
+        T value;
+        size_type run;
+    };
+
+    struct head_compare : private Compare {
+        head_compare() = default;
+        head_compare(const Compare& comp) : Compare(comp) {}
+
+        bool operator()(const head& lhs, const head& rhs) const
+        {
+            return Compare::operator()(lhs.value, rhs.value);
+        }
+    };
+
+    typedef heap<head, head_compare> head_heap;
+
+    bool top_in_runs() const
+    {
+        return ! heads.empty() && (h.empty() || h.compare()(h.top(), heads.top().value));
+    }
+
+    static std::unique_ptr<std::FILE, file_closer> create_file()
+    {
+        std::unique_ptr<std::FILE, file_closer> file(std::tmpfile());
+        if( ! file )
+            throw std::runtime_error("external_heap: cannot create temporary file");
+        return file;
+    }
+
+    static void write(std::FILE *file, const std::vector<T>& block)
+    {
+        if( std::fwrite(block.data(), sizeof(T), block.size(), file) != block.size() )
+            throw std::runtime_error("external_heap: cannot write temporary file");
+    }
+
+    // Writes the in-memory heap as a new run
+    void spill()
+    {
+        size_type level = 0;
+        while( runs_of_level(level) >= merge_width )
+            merge_runs(level++);
+        if( heads.size() == max_runs )
+            merge_runs(max_level());
+
+        auto file = create_file();
+        std::vector<T> block;
+        block.reserve(blockSize);
+        while( ! h.empty() ) {
+            block.push_back(h.pop_top());
+            if( block.size() == blockSize ) {
+                write(file.get(), block);
+                block.clear();
+            }
+        }
+        write(file.get(), block);
+
+        add_run(std::move(file), 0);
+    }
+
+    size_type runs_of_level(size_type level) const
+    {
+        return size_type(std::count_if(runs.begin(), runs.end(), [level] (const run& r) {
+            return r.file && r.level == level;
+        }));
+    }
+
+    size_type max_level() const
+    {
+        size_type level = 0;
+        for( const run& r : runs ) {
+            if( r.file )
+                level = std::max(level, r.level);
+        }
+        return level;
+    }
+
+    // Merges the runs up to the given level into one run of the next level
+    void merge_runs(size_type level)
+    {
+        head_heap merged(typename head_heap::container_type(), heads.compare());
+        for( auto it = heads.cbegin(); it != heads.cend(); ++it ) {
+            if( runs[it->run].level <= level )
+                merged.push(*it);
+        }
+        heads.erase_if([this, level] (const head& hd) { return runs[hd.run].level <= level; });
+
+        auto file = create_file();
+        std::vector<T> block;
+        block.reserve(blockSize);
+        while( ! merged.empty() ) {
+            const size_type index = merged.top().run;
+            block.push_back(merged.top().value);
+            if( advance(runs[index]) )
+                merged.replace_top(head{runs[index].block[runs[index].next], index});
+            else
+                merged.pop();
+            if( block.size() == blockSize ) {
+                write(file.get(), block);
+                block.clear();
+            }
+        }
+        write(file.get(), block);
+
+        add_run(std::move(file), level + 1);
+    }
+
+    void add_run(std::unique_ptr<std::FILE, file_closer> file, size_type level)
+    {
+        std::rewind(file.get());
+
+        // reuse the slot of an exhausted run
+        size_type index = 0;
+        while( index < runs.size() && runs[index].file )
+            ++index;
+        if( index == runs.size() )
+            runs.emplace_back();
+
+        run &r = runs[index];
+        r.file = std::move(file);
+        r.level = level;
+        read_block(r);
+        heads.push(head{r.block[0], index});
+    }
+
+    void read_block(run& r)
+    {
+        r.block.resize(blockSize);
+        r.block.resize(std::fread(r.block.data(), sizeof(T), blockSize, r.file.get()));
+        if( std::ferror(r.file.get()) )
+            throw std::runtime_error("external_heap: cannot read temporary file");
+        r.next = 0;
+    }
+
+    // Moves to the next element of a run; once it is exhausted, the run is
+    // released and false returned
+    bool advance(run& r)
+    {
+        if( ++r.next == r.block.size() )
+            read_block(r);
+        if( ! r.block.empty() )
+            return true;
+        r.file.reset();
+        r.block = std::vector<T>();
+        return false;
+    }
+
+    // Replaces the top run head by the next element of its run
+    void advance_top_run()
+    {
+        const size_type index = heads.top().run;
+        run &r = runs[index];
+        if( advance(r) )
+            heads.replace_top(head{r.block[r.next], index});
+        else
+            heads.pop();
+    }
+
+    const size_type budget;
+    const size_type heapCapacity;
+    const size_type blockSize;
+    heap_type h;
+    head_heap heads;
+    std::vector<run> runs;
+    size_type count = 0;
+};
+
+template< typename T, class Compare >
+constexpr typename external_heap<T, Compare>::size_type external_heap<T, Compare>::max_runs;
+template< typename T, class Compare >
+constexpr typename external_heap<T, Compare>::size_type external_heap<T, Compare>::merge_width;
+
+} // namespace binary_max_heap
+
+#endif // BINARY_MAX_HEAP_EXTERNAL_HEAP_H
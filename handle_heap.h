@@ -0,0 +1,387 @@
+/* Copyright 2015 Zeno Sebastian Endemann <zeno.endemann@googlemail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the licence, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BINARY_MAX_HEAP_HANDLE_HEAP_H
+#define BINARY_MAX_HEAP_HANDLE_HEAP_H
+
+#include "binary_heap.h"
+
+#include <cassert>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+
+namespace binary_max_heap {
+
+/// Stable reference to an element of a handle_heap (a generational index):
+/// it stays valid while the element is in the heap, and is detected as
+/// invalid after the element was removed, even if its slot got reused.
+template< typename Index = std::uint32_t >
+struct heap_handle {
+    Index index = std::numeric_limits<Index>::max();
+    Index generation = 0;
+
+    friend bool operator==(const heap_handle& lhs, const heap_handle& rhs)
+    {
+        return lhs.index == rhs.index && lhs.generation == rhs.generation;
+    }
+
+    friend bool operator!=(const heap_handle& lhs, const heap_handle& rhs)
+    {
+        return !(lhs == rhs);
+    }
+};
+
+/// Heap entry of handle_heap: the value and its handle slot.
+template< typename T, typename Index >
+struct handle_heap_entry {
+    T value;
+    Index slot;
+};
+
+/// Position tracker maintaining the handle slot -> heap position map of
+/// handle_heap.
+template< typename Index >
+struct handle_position_tracker {
+    struct slot {
+        std::ptrdiff_t position; // -1 if the slot is free
+        Index generation;
+        bool dead;               // lazily erased, still in the heap
+    };
+
+    template< typename Heap, typename Entry, typename DiffType >
+    void insert(const Heap& /*heap*/, const Entry& entry, DiffType position)
+    {
+        slots[entry.slot].position = position;
+    }
+
+    template< typename Heap, typename Entry, typename DiffType >
+    void move(const Heap& /*heap*/, const Entry& entry, DiffType /*oldPosition*/, DiffType newPosition)
+    {
+        slots[entry.slot].position = newPosition;
+    }
+
+    template< typename Heap, typename Entry, typename DiffType >
+    static void remove(const Heap& /*heap*/, const Entry& /*entry*/, DiffType /*position*/) {}
+
+    std::vector<slot> slots;
+    std::vector<Index> freeSlots;
+};
+
+/// Heap whose push returns a stable handle to the inserted element, so
+/// elements can be erased or changed in O(log n) without searching for
+/// them and without a user written position tracker.
+/// The handle -> position map is maintained through the position tracker
+/// hooks of the underlying heap.
+/// Elements can also be erased lazily (lazy_erase), which only marks them;
+/// the marked elements are discarded once they reach the top, or all at once
+/// when they make up more than max_dead_fraction() of the heap.
+/// All members taking a handle require it to be valid (see contains); this
+/// is asserted in debug builds, using a stale handle is undefined behaviour.
+template< typename T,
+          class Compare = std::less<T>,
+          std::size_t Arity = 2,
+          typename Index = std::uint32_t >
+class handle_heap {
+public:
+    typedef T                                               value_type;
+    typedef heap_handle<Index>                              handle;
+    typedef handle_heap_entry<T, Index>                     entry_type;
+
+private:
+    struct entry_compare : private Compare {
+        entry_compare() = default;
+        entry_compare(const Compare& comp) : Compare(comp) {}
+
+        bool operator()(const entry_type& lhs, const entry_type& rhs) const
+        {
+            return Compare::operator()(lhs.value, rhs.value);
+        }
+
+        Compare value_compare() const { return *this; }
+    };
+
+    typedef handle_position_tracker<Index>                  tracker_type;
+    typedef heap<entry_type, entry_compare, tracker_type,
+                 std::allocator<entry_type>, Arity>         heap_type;
+
+public:
+    typedef typename heap_type::size_type                   size_type;
+
+    handle_heap() = default;
+    explicit handle_heap(const Compare& comp)
+        : h(typename heap_type::container_type(), entry_compare(comp)) {}
+
+    bool empty() const { return size() == 0; }
+
+    /// Number of elements, not counting lazily erased ones.
+    size_t size() const { return h.size() - deadCount; }
+
+    /// Number of elements including the lazily erased ones still stored.
+    size_t physical_size() const { return h.size(); }
+    const T& top() const { return h.top().value; }
+
+    handle top_handle() const { return handle_of(h.top().slot); }
+
+    template< typename U >
+    handle push(U&& value)
+    {
+        const Index slot = allocate_slot();
+        h.push(entry_type{std::forward<U>(value), slot});
+        return handle_of(slot);
+    }
+
+    void pop() { erase_at(0); }
+
+    T pop_top()
+    {
+        const Index slot = h.top().slot;
+        T value = h.pop_top().value;
+        release_slot(slot);
+        discard_dead_top();
+        return value;
+    }
+
+    /// Returns true if handle refers to an element of this heap.
+    bool contains(handle hd) const
+    {
+        const auto& slots = h.position_tracker().slots;
+        return hd.index < slots.size()
+                && slots[hd.index].generation == hd.generation
+                && slots[hd.index].position >= 0;
+    }
+
+    /// Value of the element hd refers to; hd must be valid.
+    const T& value(handle hd) const { return (h.cbegin() + position(hd))->value; }
+
+    /// Erases the element hd refers to; hd must be valid.
+    void erase(handle hd) { erase_at(position(hd)); }
+
+    /// Erases the element in O(1) by only marking it, for elements that will
+    /// likely never reach the top. hd must be valid, and becomes invalid
+    /// right away.
+    /// Marked elements that do reach the top cost a pop each, and all of them
+    /// make the heap deeper, so this only pays off if few of them get there
+    /// before a compaction; measure against erase.
+    void lazy_erase(handle hd)
+    {
+        assert(contains(hd));
+        if( position(hd) == 0 ) {
+            erase_at(0);
+            return;
+        }
+
+        tracker_type& t = h.position_tracker();
+        t.slots[hd.index].dead = true;
+        ++t.slots[hd.index].generation;
+        ++deadCount;
+
+        if( double(deadCount) > maxDeadFraction * double(h.size()) )
+            compact();
+    }
+
+    /// Fraction of lazily erased elements above which they are removed all at
+    /// once with a linear rebuild.
+    double max_dead_fraction() const { return maxDeadFraction; }
+    void set_max_dead_fraction(double fraction) { maxDeadFraction = fraction; }
+
+    /// Removes all lazily erased elements.
+    void compact()
+    {
+        if( deadCount == 0 )
+            return;
+
+        h.erase_if([this] (const entry_type& e) {
+            if( ! h.position_tracker().slots[e.slot].dead )
+                return false;
+            free_slot(e.slot);
+            return true;
+        });
+        deadCount = 0;
+    }
+
+    /// Erases the element hd refers to and returns it; hd must be valid.
+    T take(handle hd)
+    {
+        const auto p = position(hd);
+        T value = h.take(h.cbegin() + p).value;
+        release_slot(hd.index);
+        discard_dead_top();
+        return value;
+    }
+
+    /// Changes the value of the element hd refers to; hd must be valid.
+    template< typename U >
+    void update(handle hd, U&& newValue)
+    {
+        h.update(h.cbegin() + position(hd), entry_type{std::forward<U>(newValue), hd.index});
+        discard_dead_top();
+    }
+
+    /// See heap::increase; hd must be valid.
+    template< typename U >
+    void increase(handle hd, U&& newValue)
+    {
+        h.increase(h.cbegin() + position(hd), entry_type{std::forward<U>(newValue), hd.index});
+    }
+
+    /// See heap::decrease; hd must be valid.
+    template< typename U >
+    void decrease(handle hd, U&& newValue)
+    {
+        h.decrease(h.cbegin() + position(hd), entry_type{std::forward<U>(newValue), hd.index});
+        discard_dead_top();
+    }
+
+    /// See heap::update_batch. Handles keep referring to their elements
+    /// during a batch, as elements only move on commit. Like there, the
+    /// destructor does not throw.
+    class update_batch {
+    public:
+        explicit update_batch(handle_heap& hh) : hh(hh), guard{hh}, batch(hh.h) {}
+
+        /// hd must be valid.
+        template< typename U >
+        void update(handle hd, U&& newValue)
+        {
+            batch.update(hh.h.cbegin() + hh.position(hd), entry_type{std::forward<U>(newValue), hd.index});
+        }
+
+        const T& top()
+        {
+            commit();
+            return hh.top();
+        }
+
+        void commit()
+        {
+            batch.commit();
+            hh.discard_dead_top();
+        }
+
+    private:
+        // Discards a lazily erased top once batch, destroyed before it, has
+        // repaired the heap
+        struct dead_top_guard {
+            handle_heap& hh;
+
+            ~dead_top_guard()
+            {
+                try {
+                    hh.discard_dead_top();
+                } catch( ... ) {}
+            }
+        };
+
+        handle_heap& hh;
+        dead_top_guard guard;
+        typename heap_type::update_batch batch;
+    };
+
+    /// Removes all elements; handles to them become invalid.
+    void clear()
+    {
+        for( auto it = h.cbegin(); it != h.cend(); ++it ) {
+            if( h.position_tracker().slots[it->slot].dead )
+                free_slot(it->slot);
+            else
+                release_slot(it->slot);
+        }
+        h.clear();
+        deadCount = 0;
+    }
+
+    void reserve(size_type n)
+    {
+        h.reserve(n);
+        h.position_tracker().slots.reserve(n);
+    }
+
+    Compare compare() const { return h.compare().value_compare(); }
+
+private:
+    std::ptrdiff_t position(handle hd) const
+    {
+        assert(contains(hd));
+        return h.position_tracker().slots[hd.index].position;
+    }
+
+    handle handle_of(Index slot) const
+    {
+        handle hd;
+        hd.index = slot;
+        hd.generation = h.position_tracker().slots[slot].generation;
+        return hd;
+    }
+
+    void erase_at(std::ptrdiff_t p)
+    {
+        const Index slot = (h.cbegin() + p)->slot;
+        h.erase(h.cbegin() + p);
+        release_slot(slot);
+        discard_dead_top();
+    }
+
+    // Keeps a live element on top, so top() can stay const
+    void discard_dead_top()
+    {
+        while( deadCount > 0 && ! h.empty() && h.position_tracker().slots[h.top().slot].dead ) {
+            const Index slot = h.top().slot;
+            h.pop();
+            free_slot(slot);
+            --deadCount;
+        }
+    }
+
+    Index allocate_slot()
+    {
+        tracker_type& t = h.position_tracker();
+        if( ! t.freeSlots.empty() ) {
+            const Index slot = t.freeSlots.back();
+            t.freeSlots.pop_back();
+            return slot;
+        }
+
+        if( t.slots.size() >= size_type(std::numeric_limits<Index>::max()) )
+            throw std::length_error("handle_heap: handle index overflow");
+        t.slots.push_back({-1, 0, false});
+        return Index(t.slots.size() - 1);
+    }
+
+    void release_slot(Index slot)
+    {
+        ++h.position_tracker().slots[slot].generation;
+        free_slot(slot);
+    }
+
+    // Slot of a lazily erased element, whose generation was already bumped
+    void free_slot(Index slot)
+    {
+        tracker_type& t = h.position_tracker();
+        t.slots[slot].position = -1;
+        t.slots[slot].dead = false;
+        t.freeSlots.push_back(slot);
+    }
+
+    heap_type h;
+    size_type deadCount = 0;
+    double maxDeadFraction = 0.5;
+};
+
+} // namespace binary_max_heap
+
+#endif // BINARY_MAX_HEAP_HANDLE_HEAP_H
@@ -0,0 +1,421 @@
+/* Copyright 2015 Zeno Sebastian Endemann <zeno.endemann@googlemail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the licence, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BINARY_MAX_HEAP_JOURNALED_HEAP_H
+#define BINARY_MAX_HEAP_JOURNALED_HEAP_H
+
+#include "binary_heap.h"
+#include "checksum.h"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace binary_max_heap {
+
+/// When journaled_heap forces written log batches to disk with fsync.
+enum class fsync_policy {
+    never,          ///< left to the operating system
+    every_batch,    ///< after every batch, so only buffered operations can be lost
+    interval        ///< after a batch once journal_options::fsyncInterval has passed
+};
+
+struct journal_options {
+    /// Operations buffered in memory before they are written as one batch.
+    std::size_t batchSize = 4096;
+    fsync_policy fsync = fsync_policy::every_batch;
+    std::chrono::milliseconds fsyncInterval = std::chrono::milliseconds(100);
+    /// Logged operations after which a checkpoint is written; 0 disables
+    /// automatic checkpoints.
+    std::size_t checkpointOperations = std::size_t(1) << 20;
+};
+
+/// Max heap of trivially copyable T that survives crashes: every push, pop,
+/// erase and update (at a position between begin() and end()) is appended
+/// to an operation log, and the heap array is
+/// written as a checkpoint now and then. Constructing a journaled_heap
+/// recovers the state of the files at path + ".ckpt" and path + ".log" (or
+/// starts empty): it loads the checkpoint and replays the log on top. As
+/// the heap algorithms are deterministic, replaying the operations with
+/// their positions reproduces the array exactly.
+/// Operations are buffered and written in batches of
+/// journal_options::batchSize, each with its own checksum; a torn or
+/// corrupt batch at the end of the log ends the replay. So after a crash
+/// the heap is the state after some prefix of the operations, which
+/// contains all batches written (and synced, see fsync_policy). flush()
+/// writes the current batch early.
+/// A checkpoint is written to a temporary file, synced and renamed over the
+/// previous one, and a new log is started; both carry a generation number,
+/// so that a log from before the checkpoint is never replayed onto it.
+/// After replaying a log, recovery writes a checkpoint right away.
+/// Throws std::runtime_error if a file cannot be read or written.
+template< typename T, class Compare = std::less<T>, std::size_t Arity = 2 >
+class journaled_heap {
+public:
+    typedef heap<T, Compare, position_tracker_nop, std::allocator<T>, Arity> heap_type;
+    typedef T                                               value_type;
+    typedef typename heap_type::const_iterator              const_iterator;
+    typedef typename heap_type::size_type                   size_type;
+
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "journaled_heap elements are written to disk as raw bytes");
+
+    explicit journaled_heap(const std::string& path, const journal_options& options = {},
+                            const Compare& comp = {})
+        : path(path), options(options), h(typename heap_type::container_type(), comp)
+    {
+        recover();
+        lastSync = std::chrono::steady_clock::now();
+    }
+
+    journaled_heap(const journaled_heap&) = delete;
+    journaled_heap& operator=(const journaled_heap&) = delete;
+
+    /// Writes and syncs the current batch; errors cannot be reported here.
+    ~journaled_heap()
+    {
+        try {
+            write_batch(true);
+        } catch( ... ) {}
+        if( logFd >= 0 )
+            ::close(logFd);
+    }
+
+    bool empty() const { return h.empty(); }
+    size_type size() const { return h.size(); }
+    const T& top() const { return h.top(); }
+
+    const_iterator begin() const { return h.cbegin(); }
+    const_iterator end() const { return h.cend(); }
+    const_iterator cbegin() const { return h.cbegin(); }
+    const_iterator cend() const { return h.cend(); }
+
+    void push(const T& value)
+    {
+        h.push(value);
+        log(op_push, 0, value);
+    }
+
+    void pop()
+    {
+        h.pop();
+        log(op_pop, 0, T());
+    }
+
+    T pop_top()
+    {
+        T value = h.pop_top();
+        log(op_pop, 0, T());
+        return value;
+    }
+
+    void erase(const_iterator position)
+    {
+        const std::uint64_t index = std::uint64_t(position - h.cbegin());
+        h.erase(position);
+        log(op_erase, index, T());
+    }
+
+    void update(const_iterator position, const T& newValue)
+    {
+        const std::uint64_t index = std::uint64_t(position - h.cbegin());
+        h.update(position, newValue);
+        log(op_update, index, newValue);
+    }
+
+    /// Writes the buffered operations as a batch, syncing as the policy says.
+    void flush() { write_batch(false); }
+
+    /// Writes the heap array as a new checkpoint and starts a new log.
+    void checkpoint()
+    {
+        write_batch(false);
+
+        const std::string tmp = path + ".ckpt.tmp";
+        const int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if( fd < 0 )
+            fail("cannot create checkpoint");
+
+        file_header head = make_header(checkpoint_magic(), generation + 1);
+        head.count = h.size();
+        const T *data = h.empty() ? nullptr : &*h.cbegin();
+        head.checksum = checksum(data, h.size() * sizeof(T));
+        const bool ok = write_all(fd, &head, sizeof(head))
+                && write_all(fd, data, h.size() * sizeof(T))
+                && ::fsync(fd) == 0;
+        ::close(fd);
+        if( ! ok || std::rename(tmp.c_str(), (path + ".ckpt").c_str()) != 0 )
+            fail("cannot write checkpoint");
+        sync_directory();
+
+        ++generation;
+        start_log();
+        sinceCheckpoint = 0;
+    }
+
+    Compare compare() const { return h.compare(); }
+
+private:
+    enum : std::uint8_t { op_push, op_pop, op_erase, op_update };
+
+    static constexpr std::size_t record_size = 1 + sizeof(std::uint64_t) + sizeof(T);
+
+    struct file_header {
+        char magic[8];
+        std::uint64_t elementSize;
+        std::uint64_t generation;
+        std::uint64_t count;        // checkpoint only
+        std::uint64_t checksum;     // checkpoint only
+    };
+
+    struct batch_header {
+        std::uint64_t records;
+        std::uint64_t checksum;
+    };
+
+    static const char *checkpoint_magic() { return "BMHJCKP1"; }
+    static const char *log_magic() { return "BMHJLOG1"; }
+
+    [[noreturn]] static void fail(const char *what)
+    {
+        throw std::runtime_error(std::string("journaled_heap: ") + what);
+    }
+
+    static file_header make_header(const char *magic, std::uint64_t generation)
+    {
+        file_header head = {};
+        std::memcpy(head.magic, magic, sizeof(head.magic));
+        head.elementSize = sizeof(T);
+        head.generation = generation;
+        return head;
+    }
+
+    static std::uint64_t checksum(const void *data, std::size_t n)
+    {
+        return checksum_detail::fnv1a(data, n);
+    }
+
+    static bool write_all(int fd, const void *data, std::size_t n)
+    {
+        const char *p = static_cast<const char*>(data);
+        while( n > 0 ) {
+            const ssize_t written = ::write(fd, p, n);
+            if( written <= 0 )
+                return false;
+            p += written;
+            n -= std::size_t(written);
+        }
+        return true;
+    }
+
+    static bool read_all(int fd, void *data, std::size_t n)
+    {
+        char *p = static_cast<char*>(data);
+        while( n > 0 ) {
+            const ssize_t got = ::read(fd, p, n);
+            if( got <= 0 )
+                return false;
+            p += got;
+            n -= std::size_t(got);
+        }
+        return true;
+    }
+
+    static bool valid_header(const file_header& head, const char *magic)
+    {
+        return std::memcmp(head.magic, magic, sizeof(head.magic)) == 0 && head.elementSize == sizeof(T);
+    }
+
+    void log(std::uint8_t op, std::uint64_t index, const T& value)
+    {
+        const std::size_t offset = batch.size();
+        batch.resize(offset + record_size);
+        char *p = batch.data() + offset;
+        std::memcpy(p, &op, 1);
+        std::memcpy(p + 1, &index, sizeof(index));
+        std::memcpy(p + 1 + sizeof(index), &value, sizeof(T));
+
+        if( batch.size() >= options.batchSize * record_size )
+            write_batch(false);
+        if( options.checkpointOperations > 0 && ++sinceCheckpoint >= options.checkpointOperations )
+            checkpoint();
+    }
+
+    void write_batch(bool forceSync)
+    {
+        if( ! batch.empty() ) {
+            batch_header head;
+            head.records = batch.size() / record_size;
+            head.checksum = checksum(batch.data(), batch.size());
+            if( ! write_all(logFd, &head, sizeof(head)) || ! write_all(logFd, batch.data(), batch.size()) )
+                fail("cannot write log");
+            batch.clear();
+            unsynced = true;
+        }
+
+        if( ! unsynced || options.fsync == fsync_policy::never )
+            return;
+        const auto now = std::chrono::steady_clock::now();
+        if( forceSync || options.fsync == fsync_policy::every_batch
+                || now - lastSync >= options.fsyncInterval ) {
+            if( ::fsync(logFd) != 0 )
+                fail("cannot sync log");
+            lastSync = now;
+            unsynced = false;
+        }
+    }
+
+    // Makes the rename of a checkpoint durable
+    void sync_directory()
+    {
+        const std::string::size_type slash = path.rfind('/');
+        const std::string dir = slash == std::string::npos ? "." : path.substr(0, slash + 1);
+        const int fd = ::open(dir.c_str(), O_RDONLY);
+        if( fd < 0 )
+            return;
+        ::fsync(fd);
+        ::close(fd);
+    }
+
+    // Truncates the log and writes its header for the current generation
+    void start_log()
+    {
+        if( logFd < 0 ) {
+            logFd = ::open((path + ".log").c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+            if( logFd < 0 )
+                fail("cannot open log");
+        }
+        const file_header head = make_header(log_magic(), generation);
+        if( ::ftruncate(logFd, 0) != 0 || ! write_all(logFd, &head, sizeof(head)) || ::fsync(logFd) != 0 )
+            fail("cannot start log");
+    }
+
+    void recover()
+    {
+        load_checkpoint();
+        replay_log();
+
+        // continue in a new log, so that a torn tail is not followed by new batches
+        if( replayed > 0 )
+            checkpoint();
+        else
+            start_log();
+    }
+
+    void load_checkpoint()
+    {
+        const int fd = ::open((path + ".ckpt").c_str(), O_RDONLY);
+        if( fd < 0 )
+            return;
+
+        file_header head;
+        bool ok = read_all(fd, &head, sizeof(head)) && valid_header(head, checkpoint_magic());
+        std::vector<T> c;
+        if( ok ) {
+            c.resize(std::size_t(head.count));
+            ok = read_all(fd, c.data(), c.size() * sizeof(T))
+                    && checksum(c.data(), c.size() * sizeof(T)) == head.checksum;
+        }
+        ::close(fd);
+        if( ! ok )
+            fail("corrupt checkpoint");
+
+        generation = head.generation;
+        h = heap_type(std::move(c), assume_heap, h.compare());
+    }
+
+    void replay_log()
+    {
+        const int fd = ::open((path + ".log").c_str(), O_RDONLY);
+        if( fd < 0 )
+            return;
+
+        file_header head;
+        if( ! read_all(fd, &head, sizeof(head)) || ! valid_header(head, log_magic())
+                || head.generation != generation ) {
+            ::close(fd);
+            return;
+        }
+
+        struct stat st;
+        std::uint64_t remaining = ::fstat(fd, &st) == 0 ? std::uint64_t(st.st_size) - sizeof(head) : 0;
+
+        batch_header bh;
+        std::vector<char> records;
+        while( remaining >= sizeof(bh) && read_all(fd, &bh, sizeof(bh)) ) {
+            remaining -= sizeof(bh);
+            if( bh.records > remaining / record_size )
+                break;
+            remaining -= bh.records * record_size;
+            records.resize(std::size_t(bh.records) * record_size);
+            if( ! read_all(fd, records.data(), records.size())
+                    || checksum(records.data(), records.size()) != bh.checksum )
+                break;
+            for( std::size_t offset = 0; offset < records.size(); offset += record_size )
+                apply(records.data() + offset);
+        }
+        ::close(fd);
+    }
+
+    void apply(const char *p)
+    {
+        std::uint8_t op;
+        std::uint64_t index;
+        T value;
+        std::memcpy(&op, p, 1);
+        std::memcpy(&index, p + 1, sizeof(index));
+        std::memcpy(&value, p + 1 + sizeof(index), sizeof(T));
+
+        if( op != op_push && (h.empty() || index >= h.size()) )
+            fail("log does not match checkpoint");
+        switch( op ) {
+        case op_push: h.push(value); break;
+        case op_pop: h.pop(); break;
+        case op_erase: h.erase(h.cbegin() + index); break;
+        case op_update: h.update(h.cbegin() + index, value); break;
+        default: fail("corrupt log record");
+        }
+        ++replayed;
+    }
+
+    const std::string path;
+    const journal_options options;
+    heap_type h;
+    std::vector<char> batch;    // records not yet written
+    int logFd = -1;
+    std::uint64_t generation = 0;
+    std::size_t sinceCheckpoint = 0;
+    std::size_t replayed = 0;
+    bool unsynced = false;
+    std::chrono::steady_clock::time_point lastSync;
+};
+
+template< typename T, class Compare, std::size_t Arity >
+constexpr std::size_t journaled_heap<T, Compare, Arity>::record_size;
+
+} // namespace binary_max_heap
+
+#endif // BINARY_MAX_HEAP_JOURNALED_HEAP_H
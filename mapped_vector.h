@@ -0,0 +1,370 @@
+/* Copyright 2015 Zeno Sebastian Endemann <zeno.endemann@googlemail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the licence, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BINARY_MAX_HEAP_MAPPED_VECTOR_H
+#define BINARY_MAX_HEAP_MAPPED_VECTOR_H
+
+#include "binary_heap.h"
+#include "checksum.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace binary_max_heap {
+
+/// Heap container for trivially copyable T whose array lives in a memory
+/// mapped file (POSIX), so that a heap survives a restart without being
+/// rebuilt: open the file again and pass the container to the heap
+/// constructor taking assume_heap.
+/// The file starts with a header holding the element size, a caller chosen
+/// tag identifying the comparator, the element count and a checksum of the
+/// elements. Opening an existing file checks all of these and that the file
+/// was closed cleanly (the header is marked dirty while it is open), and
+/// throws std::runtime_error otherwise; the caller then has to rebuild from
+/// elsewhere. Verifying the checksum reads the whole array; pass
+/// verify = false to open in O(1) and only check the header.
+/// The file is grown by remapping it in extents of at least twice the
+/// capacity, rounded to extent_size bytes; as the pages stay in the file,
+/// growing never copies elements. On destruction the count and checksum are
+/// written, the mapping is synced and the file truncated to its content.
+/// A default constructed container is backed by anonymous memory instead.
+/// It can only be moved, not copied. Growing remaps the array to another
+/// address, so it invalidates pointers and references as well as iterators;
+/// shrink_to_fit does nothing, and allocator_type is only nominal, as the
+/// memory always comes from mmap.
+template< typename T >
+class mapped_vector {
+public:
+    typedef T                                               value_type;
+    typedef std::allocator<T>                               allocator_type;
+    typedef T*                                              iterator;
+    typedef const T*                                        const_iterator;
+    typedef T&                                              reference;
+    typedef const T&                                        const_reference;
+    typedef std::size_t                                     size_type;
+    typedef std::ptrdiff_t                                  difference_type;
+
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "mapped_vector elements are stored in a file as raw bytes");
+
+    /// Size of the file header, which is also the alignment of the array.
+    static constexpr size_type header_size = 64;
+    static_assert(alignof(T) <= header_size, "mapped_vector does not support this alignment");
+
+    /// Granularity in bytes by which the file grows.
+    static constexpr size_type extent_size = size_type(1) << 20;
+
+    mapped_vector() = default;
+
+    /// Opens the file at path, or creates it empty if it does not exist.
+    explicit mapped_vector(const std::string& path, std::uint64_t tag = 0, bool verify = true)
+    {
+        fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+        if( fd < 0 )
+            throw std::runtime_error("mapped_vector: cannot open " + path);
+
+        try {
+            struct stat st;
+            if( ::fstat(fd, &st) != 0 )
+                fail("cannot stat file");
+
+            if( st.st_size == 0 ) {
+                map(header_size + extent_size);
+                header_data h = {};
+                std::memcpy(h.magic, magic(), sizeof(h.magic));
+                h.elementSize = sizeof(T);
+                h.tag = tag;
+                write_header(h);
+            } else {
+                if( size_type(st.st_size) < header_size )
+                    fail("file too small for a header");
+                map(size_type(st.st_size));
+
+                header_data h = read_header();
+                if( std::memcmp(h.magic, magic(), sizeof(h.magic)) != 0 )
+                    fail("not a mapped_vector file");
+                if( h.elementSize != sizeof(T) )
+                    fail("element size mismatch");
+                if( h.tag != tag )
+                    fail("comparator tag mismatch");
+                if( h.clean == 0 )
+                    fail("file was not closed cleanly");
+                if( h.count > (bytes - header_size) / sizeof(T) )
+                    fail("count exceeds file size");
+                count = size_type(h.count);
+                if( verify && h.checksum != checksum() )
+                    fail("checksum mismatch");
+            }
+
+            // marked dirty until closed again
+            header_data h = read_header();
+            h.clean = 0;
+            write_header(h);
+            if( ::msync(base, header_size, MS_SYNC) != 0 )
+                fail("cannot sync header");
+        } catch( ... ) {
+            release();
+            throw;
+        }
+    }
+
+    mapped_vector(const mapped_vector&) = delete;
+    mapped_vector& operator=(const mapped_vector&) = delete;
+
+    mapped_vector(mapped_vector&& other) noexcept { take(other); }
+    mapped_vector& operator=(mapped_vector&& other) noexcept
+    {
+        if( &other != this ) {
+            close();
+            take(other);
+        }
+        return *this;
+    }
+
+    ~mapped_vector() { close(); }
+
+    iterator begin() { return data(); }
+    iterator end() { return data() + count; }
+    const_iterator begin() const { return cbegin(); }
+    const_iterator end() const { return cend(); }
+    const_iterator cbegin() const { return data(); }
+    const_iterator cend() const { return data() + count; }
+
+    bool empty() const { return count == 0; }
+    size_type size() const { return count; }
+
+    reference operator[] ( size_type n ) { return data()[n]; }
+    const_reference operator[] ( size_type n ) const { return data()[n]; }
+    reference at( size_type n ) { check_index(n); return data()[n]; }
+    const_reference at( size_type n ) const { check_index(n); return data()[n]; }
+    reference front() { return data()[0]; }
+    const_reference front() const { return data()[0]; }
+    reference back() { return data()[count - 1]; }
+    const_reference back() const { return data()[count - 1]; }
+
+    void push_back(const T& value)
+    {
+        if( count == capacity() ) {
+            const T copy = value; // value may be an element, moved by grow()
+            grow(count + 1);
+            data()[count++] = copy;
+            return;
+        }
+        data()[count++] = value;
+    }
+    void pop_back() { --count; }
+
+    void clear() noexcept { count = 0; }
+
+    size_type capacity() const noexcept { return bytes > header_size ? (bytes - header_size) / sizeof(T) : 0; }
+    void reserve(size_type n)
+    {
+        if( n > capacity() )
+            remap(n);
+    }
+    void shrink_to_fit() {}
+
+    allocator_type get_allocator() const { return allocator_type(); }
+
+    /// Whether the array is backed by a file.
+    bool is_mapped_file() const { return fd >= 0; }
+
+    /// Writes count and checksum and flushes the mapping to the file; the
+    /// header is marked clean only by the destructor.
+    void sync()
+    {
+        if( fd < 0 )
+            return;
+        header_data h = read_header();
+        h.count = count;
+        h.checksum = checksum();
+        write_header(h);
+        if( ::msync(base, bytes, MS_SYNC) != 0 )
+            fail("cannot sync file");
+    }
+
+    friend bool operator==(const mapped_vector& lhs, const mapped_vector& rhs)
+    {
+        return lhs.size() == rhs.size() && std::equal(lhs.begin(), lhs.end(), rhs.begin());
+    }
+
+    friend bool operator!=(const mapped_vector& lhs, const mapped_vector& rhs)
+    {
+        return !(lhs == rhs);
+    }
+
+private:
+    struct header_data {
+        char magic[8];
+        std::uint64_t elementSize;
+        std::uint64_t tag;
+        std::uint64_t count;
+        std::uint64_t checksum;
+        std::uint64_t clean;
+    };
+    static_assert(sizeof(header_data) <= header_size, "header does not fit");
+
+    static const char *magic() { return "BMHEAPv1"; }
+
+    [[noreturn]] static void fail(const char *what)
+    {
+        throw std::runtime_error(std::string("mapped_vector: ") + what);
+    }
+
+    void check_index(size_type n) const
+    {
+        if( n >= count )
+            throw std::out_of_range("mapped_vector::at");
+    }
+
+    T *data() const
+    {
+        return base ? reinterpret_cast<T*>(static_cast<char*>(base) + header_size) : nullptr;
+    }
+
+    header_data read_header() const
+    {
+        header_data h;
+        std::memcpy(&h, base, sizeof(h));
+        return h;
+    }
+
+    void write_header(const header_data& h) { std::memcpy(base, &h, sizeof(h)); }
+
+    std::uint64_t checksum() const { return checksum_detail::fnv1a(data(), count * sizeof(T)); }
+
+    void grow(size_type needed)
+    {
+        remap(std::max(needed, 2 * capacity()));
+    }
+
+    // Maps room for at least n elements, in whole extents
+    void remap(size_type n)
+    {
+        size_type newBytes = header_size + n * sizeof(T);
+        newBytes = (newBytes + extent_size - 1) / extent_size * extent_size;
+
+        if( fd < 0 ) {
+            void *p = ::mmap(nullptr, newBytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if( p == MAP_FAILED )
+                throw std::bad_alloc();
+            if( base ) {
+                std::memcpy(p, base, header_size + count * sizeof(T));
+                ::munmap(base, bytes);
+            }
+            base = p;
+            bytes = newBytes;
+            return;
+        }
+
+        map(newBytes);
+    }
+
+    // Sizes the file to n bytes and maps it. A previous mapping is only
+    // unmapped once the new one exists, so that on failure it stays intact;
+    // the file never shrinks here, so the old mapping stays valid meanwhile.
+    void map(size_type n)
+    {
+        if( ::ftruncate(fd, off_t(n)) != 0 )
+            fail("cannot resize file");
+        void *p = ::mmap(nullptr, n, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if( p == MAP_FAILED )
+            fail("cannot map file");
+        if( base )
+            ::munmap(base, bytes);
+        base = p;
+        bytes = n;
+    }
+
+    void take(mapped_vector& other)
+    {
+        fd = other.fd;
+        base = other.base;
+        bytes = other.bytes;
+        count = other.count;
+        other.fd = -1;
+        other.base = nullptr;
+        other.bytes = 0;
+        other.count = 0;
+    }
+
+    // Marks the file clean and truncates it to its content. Errors cannot
+    // be reported here, but a failed write shows on reopening as a
+    // checksum mismatch or an unclean file.
+    void close() noexcept
+    {
+        if( fd >= 0 && base ) {
+            header_data h = read_header();
+            h.count = count;
+            h.checksum = checksum();
+            write_header(h);
+            if( ::msync(base, bytes, MS_SYNC) == 0 ) {
+                h.clean = 1;
+                write_header(h);
+                ::msync(base, header_size, MS_SYNC);
+            }
+            ::munmap(base, bytes);
+            base = nullptr;
+            if( h.clean )
+                (void)::ftruncate(fd, off_t(header_size + count * sizeof(T)));
+        }
+        release();
+    }
+
+    void release() noexcept
+    {
+        if( base )
+            ::munmap(base, bytes);
+        if( fd >= 0 )
+            ::close(fd);
+        fd = -1;
+        base = nullptr;
+        bytes = 0;
+        count = 0;
+    }
+
+    int fd = -1;
+    void *base = nullptr;   // header followed by the array
+    size_type bytes = 0;    // mapped length
+    size_type count = 0;
+};
+
+template< typename T >
+constexpr typename mapped_vector<T>::size_type mapped_vector<T>::header_size;
+template< typename T >
+constexpr typename mapped_vector<T>::size_type mapped_vector<T>::extent_size;
+
+/// Heap whose array lives in a memory mapped file (see mapped_vector).
+template< typename T,
+          class Compare = std::less<T>,
+          class PositionTracker = position_tracker_nop,
+          std::size_t Arity = 2 >
+using mapped_heap = heap<T, Compare, PositionTracker, std::allocator<T>, Arity, mapped_vector<T>>;
+
+} // namespace binary_max_heap
+
+#endif // BINARY_MAX_HEAP_MAPPED_VECTOR_H
@@ -0,0 +1,179 @@
+/* Copyright 2015 Zeno Sebastian Endemann <zeno.endemann@googlemail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the licence, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BINARY_MAX_HEAP_MULTI_QUEUE_H
+#define BINARY_MAX_HEAP_MULTI_QUEUE_H
+
+#include "binary_heap.h"
+#include "concurrent_heap.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <thread>
+
+namespace binary_max_heap {
+
+/// Relaxed concurrent max priority queue (Rihani, Sanders, Dementiev:
+/// "MultiQueues: Simple Relaxed Concurrent Priority Queues", 2015).
+/// Elements are spread over shardsPerThread * threads independent heaps,
+/// each behind a spin lock. push inserts into a random shard, try_pop
+/// removes the greater top of two random shards; both only try-lock shards
+/// and pick others if they are busy. Only when try_pop keeps finding empty
+/// shards does it lock every shard in turn, blocking, so that it returns
+/// false only if the queue was empty.
+/// A popped element is thus not necessarily the greatest one: its rank error
+/// (the number of greater elements still queued) is on average in the order
+/// of the shard count, with an exponentially decaying tail. In exchange,
+/// threads rarely contend on the same lock.
+/// Compare has to be default constructible.
+template< typename T,
+          class Compare = std::less<T>,
+          std::size_t Arity = 2 >
+class multi_queue {
+public:
+    typedef T                                                       value_type;
+    typedef heap<T, Compare, position_tracker_nop, std::allocator<T>, Arity> heap_type;
+    typedef std::size_t                                             size_type;
+
+    /// threads is the expected number of concurrently accessing threads,
+    /// 0 meaning std::thread::hardware_concurrency().
+    explicit multi_queue(unsigned threads = 0, unsigned shardsPerThread = 2, const Compare& comp = {})
+        : comp(comp),
+          shardCount(shard_count(threads, shardsPerThread)),
+          shards(new shard[shardCount])
+    {
+        for( size_type i = 0; i < shardCount; ++i )
+            shards[i].h = heap_type(typename heap_type::container_type(), comp);
+    }
+
+    multi_queue(const multi_queue&) = delete;
+    multi_queue& operator=(const multi_queue&) = delete;
+
+    template< typename U >
+    void push(U&& value)
+    {
+        shard *s;
+        do {
+            s = &shards[random_shard()];
+        } while( ! s->lock.try_lock() );
+
+        s->h.push(std::forward<U>(value));
+        s->count.store(s->h.size(), std::memory_order_relaxed);
+        s->lock.unlock();
+    }
+
+    /// Removes an element close to the top into value; returns false if all
+    /// shards were found empty.
+    bool try_pop(T& value)
+    {
+        for( int attempt = 0; attempt < 2 * int(shardCount); ++attempt ) {
+            shard *a = &shards[random_shard()];
+            shard *b = &shards[random_shard()];
+            if( a == b || b->count.load(std::memory_order_relaxed) == 0 )
+                b = nullptr;
+            if( a->count.load(std::memory_order_relaxed) == 0 ) {
+                a = b;
+                b = nullptr;
+            }
+            if( ! a || ! a->lock.try_lock() )
+                continue;
+            if( b && ! b->lock.try_lock() )
+                b = nullptr;
+
+            shard *best = a;
+            if( b && ! b->h.empty() && (a->h.empty() || comp(a->h.top(), b->h.top())) )
+                best = b;
+            const bool found = take_top(*best, value);
+            a->lock.unlock();
+            if( b )
+                b->lock.unlock();
+            if( found )
+                return true;
+        }
+
+        // (nearly) empty: look at every shard, so that false means empty
+        for( size_type i = 0; i < shardCount; ++i ) {
+            shards[i].lock.lock();
+            const bool found = take_top(shards[i], value);
+            shards[i].lock.unlock();
+            if( found )
+                return true;
+        }
+        return false;
+    }
+
+    /// Number of elements; only a snapshot under concurrent modification.
+    size_type size() const
+    {
+        size_type n = 0;
+        for( size_type i = 0; i < shardCount; ++i )
+            n += shards[i].count.load(std::memory_order_relaxed);
+        return n;
+    }
+
+    bool empty() const { return size() == 0; }
+    size_type shard_count() const { return shardCount; }
+
+    Compare compare() const { return comp; }
+
+private:
+    struct shard {
+        spin_lock lock;
+        std::atomic<size_type> count{0};
+        heap_type h;
+        char padding[64]; // keep the locks of neighbouring shards apart
+    };
+
+    static size_type shard_count(unsigned threads, unsigned shardsPerThread)
+    {
+        if( threads == 0 )
+            threads = std::max(1u, std::thread::hardware_concurrency());
+        return std::max<size_type>(2, size_type(threads) * std::max(1u, shardsPerThread));
+    }
+
+    bool take_top(shard& s, T& value)
+    {
+        if( s.h.empty() )
+            return false;
+        value = s.h.pop_top();
+        s.count.store(s.h.size(), std::memory_order_relaxed);
+        return true;
+    }
+
+    size_type random_shard() const
+    {
+        // per thread xorshift generator, seeded by the thread identity
+        static thread_local std::uint64_t state = 0;
+        if( state == 0 )
+            state = std::hash<std::thread::id>()(std::this_thread::get_id()) | 1;
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        return size_type(state % shardCount);
+    }
+
+    const Compare comp;
+    const size_type shardCount;
+    std::unique_ptr<shard[]> shards;
+};
+
+} // namespace binary_max_heap
+
+#endif // BINARY_MAX_HEAP_MULTI_QUEUE_H
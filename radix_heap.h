@@ -0,0 +1,219 @@
+/* Copyright 2015 Zeno Sebastian Endemann <zeno.endemann@googlemail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the licence, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BINARY_MAX_HEAP_RADIX_HEAP_H
+#define BINARY_MAX_HEAP_RADIX_HEAP_H
+
+#include <algorithm>
+#include <cassert>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace binary_max_heap {
+
+/// Default KeyOf of radix_heap: the element is its own key.
+struct radix_identity_key {
+    template< typename T >
+    const T& operator()(const T& value) const { return value; }
+};
+
+/// Radix heap (Ahuja, Mehlhorn, Orlin, Tarjan: "Faster algorithms for the
+/// shortest path problem", 1990) for elements with unsigned integer keys,
+/// given by KeyOf. Unlike heap, top() is the element with the *smallest* key,
+/// and the keys have to be monotone: push must not be given a key smaller than
+/// the key of the last element returned by top() or removed by pop(), as is
+/// the case for timer deadlines or Dijkstra distances; such a key makes push
+/// throw std::invalid_argument.
+/// Elements are kept in one bucket per bit of the key, by the highest bit in
+/// which their key differs from the last minimum. push is O(1) without any
+/// comparison; once the minimum bucket runs empty, the next non-empty bucket
+/// is redistributed, which moves every element at most once per bit, so pop is
+/// amortized O(log C) for keys up to C.
+/// The redistribution is done by top(), which is therefore not const: unlike
+/// with the other heaps, concurrent calls of top() need synchronization.
+template< typename T, class KeyOf = radix_identity_key >
+class radix_heap : private KeyOf {
+public:
+    typedef T                                               value_type;
+    typedef typename std::decay<decltype(std::declval<KeyOf>()(std::declval<const T&>()))>::type
+                                                            key_type;
+    typedef std::size_t                                     size_type;
+
+    static_assert(std::is_integral<key_type>::value && std::is_unsigned<key_type>::value,
+                  "radix_heap keys have to be unsigned integers");
+
+    radix_heap() = default;
+    explicit radix_heap(const KeyOf& keyOf) : KeyOf(keyOf) {}
+
+    bool empty() const { return count == 0; }
+    size_type size() const { return count; }
+
+    /// The element with the smallest key; the heap must not be empty.
+    const T& top()
+    {
+        assert(count > 0);
+        if( buckets[0].empty() )
+            refill();
+        return buckets[0].back().value;
+    }
+
+    /// Key of the last element returned by top() or removed by pop(), i.e. the
+    /// smallest key that may still be pushed.
+    key_type last_key() const { return last; }
+
+    void push(const T& value)
+    {
+        const key_type k = checked_key(value);
+        buckets[bucket(k)].push_back(entry{k, value});
+        ++count;
+    }
+
+    void push(T&& value)
+    {
+        const key_type k = checked_key(value);
+        buckets[bucket(k)].push_back(entry{k, std::move(value)});
+        ++count;
+    }
+
+    template< typename... Args >
+    void emplace(Args&&... args)
+    {
+        push(T(std::forward<Args>(args)...));
+    }
+
+    void pop()
+    {
+        top();
+        buckets[0].pop_back();
+        --count;
+    }
+
+    T pop_top()
+    {
+        top();
+        T value = std::move(buckets[0].back().value);
+        buckets[0].pop_back();
+        --count;
+        return value;
+    }
+
+    /// Removes all elements for which pred returns true; returns their number.
+    /// The remaining elements stay in their buckets, so this is a single pass.
+    template< class Predicate >
+    size_type erase_if(Predicate pred)
+    {
+        size_type removed = 0;
+        for( auto &b : buckets ) {
+            auto last = std::remove_if(b.begin(), b.end(), [&pred] (const entry& e) {
+                return pred(e.value);
+            });
+            removed += size_type(b.end() - last);
+            b.erase(last, b.end());
+        }
+        count -= removed;
+        return removed;
+    }
+
+    void clear()
+    {
+        for( auto &b : buckets )
+            b.clear();
+        count = 0;
+    }
+
+    KeyOf key_of() const { return *this; }
+
+private:
+    static constexpr int key_bits = std::numeric_limits<key_type>::digits;
+
+    // the key is stored along, so that redistributing does not need to
+    // look into the elements again (e.g. through a pointer)
+    struct entry {
+        key_type key;
+        T value;
+    };
+
+    key_type key(const T& value) const { return KeyOf::operator()(value); }
+
+    key_type checked_key(const T& value) const
+    {
+        const key_type k = key(value);
+        if( k < last )
+            throw std::invalid_argument("radix_heap: key below the last minimum");
+        return k;
+    }
+
+    // 0 for the last minimum itself, else the number of significant bits of
+    // the difference pattern to it
+    int bucket(key_type k) const
+    {
+        assert(k >= last);
+        return bit_width(k ^ last);
+    }
+
+    static int bit_width(key_type x)
+    {
+#if defined(__GNUC__)
+        if( x == 0 )
+            return 0;
+        if( sizeof(key_type) <= sizeof(unsigned int) )
+            return std::numeric_limits<unsigned int>::digits - __builtin_clz((unsigned int)x);
+        return std::numeric_limits<unsigned long long>::digits - __builtin_clzll((unsigned long long)x);
+#else
+        int n = 0;
+        for( ; x != 0; x >>= 1 )
+            ++n;
+        return n;
+#endif
+    }
+
+    // Moves the smallest keys into bucket 0, by redistributing the first
+    // non-empty bucket around its minimum; all its elements land in lower
+    // buckets, as they agree with the new minimum above their highest bit
+    void refill()
+    {
+        int i = 1;
+        while( buckets[i].empty() )
+            ++i;
+
+        std::vector<entry> &b = buckets[i];
+        key_type minKey = b.front().key;
+        for( const entry& e : b ) {
+            if( e.key < minKey )
+                minKey = e.key;
+        }
+
+        last = minKey;
+        for( entry& e : b )
+            buckets[bucket(e.key)].push_back(std::move(e));
+        b.clear();
+    }
+
+    std::vector<entry> buckets[key_bits + 1];
+    key_type last = 0;
+    size_type count = 0;
+};
+
+template< typename T, class KeyOf >
+constexpr int radix_heap<T, KeyOf>::key_bits;
+
+} // namespace binary_max_heap
+
+#endif // BINARY_MAX_HEAP_RADIX_HEAP_H
@@ -0,0 +1,302 @@
+/* Copyright 2015 Zeno Sebastian Endemann <zeno.endemann@googlemail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the licence, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BINARY_MAX_HEAP_SEGMENTED_VECTOR_H
+#define BINARY_MAX_HEAP_SEGMENTED_VECTOR_H
+
+#include "binary_heap.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace binary_max_heap {
+
+/// Heap container that stores its elements in blocks of BlockSize (a power
+/// of two) elements, found through a directory of block pointers. Growing
+/// allocates a new block and never moves existing elements, so unlike
+/// std::vector there is no stall copying the whole array when the capacity
+/// is exceeded; only the directory (one pointer per block) is reallocated.
+/// An index is split into block and offset by a shift and a mask, so an
+/// element access costs one more dependent load than with a plain array.
+/// pop_back frees blocks with hysteresis: a block is only freed once more
+/// than spare_blocks() blocks are unused, so pushing and popping around a
+/// block boundary does not allocate each time.
+/// References stay valid as long as their element exists; iterators, like
+/// those of std::vector, are invalidated by push_back. The elements are not
+/// contiguous, so there is no data(), and the iterators are not pointers.
+template< typename T, std::size_t BlockSize = 4096, class Alloc = std::allocator<T> >
+class segmented_vector {
+    typedef std::allocator_traits<Alloc> alloc_traits;
+    typedef std::vector<T*, typename alloc_traits::template rebind_alloc<T*>> directory_type;
+
+    static_assert(BlockSize > 0 && (BlockSize & (BlockSize - 1)) == 0,
+                  "BlockSize must be a power of two");
+
+public:
+    typedef T                                               value_type;
+    typedef Alloc                                           allocator_type;
+    typedef T&                                              reference;
+    typedef const T&                                        const_reference;
+    typedef std::size_t                                     size_type;
+    typedef std::ptrdiff_t                                  difference_type;
+
+    /// Random access iterator, an index into the block directory.
+    template< bool Const >
+    class basic_iterator {
+    public:
+        typedef std::random_access_iterator_tag                             iterator_category;
+        typedef T                                                           value_type;
+        typedef std::ptrdiff_t                                              difference_type;
+        typedef typename std::conditional<Const, const T*, T*>::type        pointer;
+        typedef typename std::conditional<Const, const T&, T&>::type        reference;
+
+        basic_iterator() = default;
+        basic_iterator(T *const *blocks, difference_type index) : blocks(blocks), index(index) {}
+        template< bool C, typename = typename std::enable_if<Const && ! C>::type >
+        basic_iterator(const basic_iterator<C>& other) : blocks(other.blocks), index(other.index) {}
+
+        reference operator*() const { return blocks[size_type(index) / BlockSize][size_type(index) % BlockSize]; }
+        pointer operator->() const { return &**this; }
+        reference operator[](difference_type n) const { return *(*this + n); }
+
+        basic_iterator& operator++() { ++index; return *this; }
+        basic_iterator operator++(int) { basic_iterator it = *this; ++index; return it; }
+        basic_iterator& operator--() { --index; return *this; }
+        basic_iterator operator--(int) { basic_iterator it = *this; --index; return it; }
+        basic_iterator& operator+=(difference_type n) { index += n; return *this; }
+        basic_iterator& operator-=(difference_type n) { index -= n; return *this; }
+
+        friend basic_iterator operator+(basic_iterator it, difference_type n) { return it += n; }
+        friend basic_iterator operator+(difference_type n, basic_iterator it) { return it += n; }
+        friend basic_iterator operator-(basic_iterator it, difference_type n) { return it -= n; }
+        friend difference_type operator-(const basic_iterator& lhs, const basic_iterator& rhs)
+        {
+            return lhs.index - rhs.index;
+        }
+
+        friend bool operator==(const basic_iterator& lhs, const basic_iterator& rhs) { return lhs.index == rhs.index; }
+        friend bool operator!=(const basic_iterator& lhs, const basic_iterator& rhs) { return lhs.index != rhs.index; }
+        friend bool operator<(const basic_iterator& lhs, const basic_iterator& rhs) { return lhs.index < rhs.index; }
+        friend bool operator>(const basic_iterator& lhs, const basic_iterator& rhs) { return lhs.index > rhs.index; }
+        friend bool operator<=(const basic_iterator& lhs, const basic_iterator& rhs) { return lhs.index <= rhs.index; }
+        friend bool operator>=(const basic_iterator& lhs, const basic_iterator& rhs) { return lhs.index >= rhs.index; }
+
+    private:
+        friend class basic_iterator<true>;
+
+        T *const *blocks = nullptr;
+        difference_type index = 0;
+    };
+
+    typedef basic_iterator<false>                           iterator;
+    typedef basic_iterator<true>                            const_iterator;
+
+    static constexpr size_type block_size = BlockSize;
+
+    segmented_vector() = default;
+    explicit segmented_vector(const allocator_type& alloc) : alloc(alloc), blocks(alloc) {}
+    segmented_vector(std::initializer_list<T> il, const allocator_type& alloc = {})
+        : alloc(alloc), blocks(alloc) { assign(il.begin(), il.end()); }
+
+    segmented_vector(const segmented_vector& other)
+        : segmented_vector(other, alloc_traits::select_on_container_copy_construction(other.alloc)) {}
+    segmented_vector(segmented_vector&& other) noexcept
+        : alloc(std::move(other.alloc)), blocks(std::move(other.blocks)),
+          count(other.count), spare(other.spare)
+    {
+        other.blocks.clear();
+        other.count = 0;
+    }
+    segmented_vector(const segmented_vector& other, const allocator_type& alloc)
+        : alloc(alloc), blocks(alloc), spare(other.spare) { assign(other.begin(), other.end()); }
+    segmented_vector(segmented_vector&& other, const allocator_type& alloc)
+        : alloc(alloc), blocks(alloc), spare(other.spare)
+    {
+        if( alloc == other.alloc )
+            steal(other);
+        else
+            assign(std::make_move_iterator(other.begin()), std::make_move_iterator(other.end()));
+    }
+
+    ~segmented_vector() { release(); }
+
+    segmented_vector& operator=(const segmented_vector& other)
+    {
+        if( &other != this ) {
+            spare = other.spare;
+            assign(other.begin(), other.end());
+        }
+        return *this;
+    }
+    segmented_vector& operator=(segmented_vector&& other)
+    {
+        if( &other == this )
+            return *this;
+        if( alloc_traits::propagate_on_container_move_assignment::value || alloc == other.alloc ) {
+            release();
+            if( alloc_traits::propagate_on_container_move_assignment::value )
+                alloc = std::move(other.alloc);
+            steal(other);
+        } else {
+            assign(std::make_move_iterator(other.begin()), std::make_move_iterator(other.end()));
+        }
+        return *this;
+    }
+    segmented_vector& operator=(std::initializer_list<T> il)
+    {
+        assign(il.begin(), il.end());
+        return *this;
+    }
+
+    template< typename InputIt >
+    void assign(InputIt first, InputIt last)
+    {
+        clear();
+        for( ; first != last; ++first )
+            push_back(*first);
+    }
+
+    iterator begin() { return iterator(blocks.data(), 0); }
+    iterator end() { return iterator(blocks.data(), difference_type(count)); }
+    const_iterator begin() const { return cbegin(); }
+    const_iterator end() const { return cend(); }
+    const_iterator cbegin() const { return const_iterator(blocks.data(), 0); }
+    const_iterator cend() const { return const_iterator(blocks.data(), difference_type(count)); }
+
+    bool empty() const { return count == 0; }
+    size_type size() const { return count; }
+
+    reference operator[] ( size_type n ) { return blocks[n / BlockSize][n % BlockSize]; }
+    const_reference operator[] ( size_type n ) const { return blocks[n / BlockSize][n % BlockSize]; }
+    reference at( size_type n ) { check_index(n); return (*this)[n]; }
+    const_reference at( size_type n ) const { check_index(n); return (*this)[n]; }
+    reference front() { return (*this)[0]; }
+    const_reference front() const { return (*this)[0]; }
+    reference back() { return (*this)[count - 1]; }
+    const_reference back() const { return (*this)[count - 1]; }
+
+    void push_back(const T& value) { emplace_back(value); }
+    void push_back(T&& value) { emplace_back(std::move(value)); }
+
+    template< typename... Args >
+    void emplace_back(Args&&... args)
+    {
+        if( count == capacity() )
+            blocks.push_back(alloc_traits::allocate(alloc, BlockSize));
+        alloc_traits::construct(alloc, &(*this)[count], std::forward<Args>(args)...);
+        ++count;
+    }
+
+    void pop_back()
+    {
+        alloc_traits::destroy(alloc, &back());
+        --count;
+        if( count % BlockSize == 0 )
+            free_blocks(count / BlockSize + spare);
+    }
+
+    /// Destroys all elements; the blocks are kept, like the capacity of
+    /// std::vector.
+    void clear() noexcept
+    {
+        for( size_type i = 0; i < count; ++i )
+            alloc_traits::destroy(alloc, &(*this)[i]);
+        count = 0;
+    }
+
+    size_type capacity() const noexcept { return blocks.size() * BlockSize; }
+    void reserve(size_type n)
+    {
+        blocks.reserve((n + BlockSize - 1) / BlockSize);
+        while( capacity() < n )
+            blocks.push_back(alloc_traits::allocate(alloc, BlockSize));
+    }
+    void shrink_to_fit() { free_blocks((count + BlockSize - 1) / BlockSize); }
+
+    /// Number of unused blocks pop_back keeps allocated (default 1).
+    size_type spare_blocks() const { return spare; }
+    void set_spare_blocks(size_type n) { spare = n; }
+
+    allocator_type get_allocator() const { return alloc; }
+
+    friend bool operator==(const segmented_vector& lhs, const segmented_vector& rhs)
+    {
+        return lhs.size() == rhs.size() && std::equal(lhs.begin(), lhs.end(), rhs.begin());
+    }
+
+    friend bool operator!=(const segmented_vector& lhs, const segmented_vector& rhs)
+    {
+        return !(lhs == rhs);
+    }
+
+private:
+    void check_index(size_type n) const
+    {
+        if( n >= count )
+            throw std::out_of_range("segmented_vector::at");
+    }
+
+    // Frees the blocks beyond the first n
+    void free_blocks(size_type n)
+    {
+        while( blocks.size() > n ) {
+            alloc_traits::deallocate(alloc, blocks.back(), BlockSize);
+            blocks.pop_back();
+        }
+    }
+
+    void release()
+    {
+        clear();
+        free_blocks(0);
+    }
+
+    void steal(segmented_vector& other)
+    {
+        blocks = std::move(other.blocks);
+        count = other.count;
+        other.blocks.clear();
+        other.count = 0;
+    }
+
+    allocator_type alloc;
+    directory_type blocks;
+    size_type count = 0;
+    size_type spare = 1;
+};
+
+template< typename T, std::size_t BlockSize, class Alloc >
+constexpr typename segmented_vector<T, BlockSize, Alloc>::size_type segmented_vector<T, BlockSize, Alloc>::block_size;
+
+/// Heap using a segmented_vector as storage.
+template< typename T,
+          class Compare = std::less<T>,
+          class PositionTracker = position_tracker_nop,
+          std::size_t Arity = 2,
+          std::size_t BlockSize = 4096 >
+using segmented_heap = heap<T, Compare, PositionTracker, std::allocator<T>, Arity,
+                            segmented_vector<T, BlockSize>>;
+
+} // namespace binary_max_heap
+
+#endif // BINARY_MAX_HEAP_SEGMENTED_VECTOR_H
@@ -0,0 +1,327 @@
+/* Copyright 2015 Zeno Sebastian Endemann <zeno.endemann@googlemail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the licence, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BINARY_MAX_HEAP_SMALL_VECTOR_H
+#define BINARY_MAX_HEAP_SMALL_VECTOR_H
+
+#include "binary_heap.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+namespace binary_max_heap {
+
+/// Heap container with room for N elements inside the object itself, so
+/// that small heaps need no allocation and their elements share the cache
+/// lines of the heap object. If Spill is true, it moves its elements to
+/// storage from Alloc once it grows beyond N (like a small_vector), and back
+/// into the object on shrink_to_fit when they fit again. If Spill is false
+/// (see static_vector), the capacity is fixed to N and nothing is ever
+/// allocated, which bounds the time of every operation; pushing into a full
+/// container throws std::length_error.
+/// Moving a container whose elements are inline moves them one by one, so
+/// it takes O(N) instead of O(1), and pointers into the source do not carry
+/// over to the target. There is no insert, erase, resize or swap.
+template< typename T, std::size_t N, class Alloc = std::allocator<T>, bool Spill = true >
+class small_vector {
+    typedef std::allocator_traits<Alloc> alloc_traits;
+
+    static_assert(N > 0, "N must not be 0");
+
+public:
+    typedef T                                               value_type;
+    typedef Alloc                                           allocator_type;
+    typedef T*                                              iterator;
+    typedef const T*                                        const_iterator;
+    typedef T&                                              reference;
+    typedef const T&                                        const_reference;
+    typedef std::size_t                                     size_type;
+    typedef std::ptrdiff_t                                  difference_type;
+
+    static constexpr size_type inline_capacity = N;
+    static constexpr bool spills = Spill;
+
+    small_vector() = default;
+    explicit small_vector(const allocator_type& alloc) : alloc(alloc) {}
+    small_vector(std::initializer_list<T> il, const allocator_type& alloc = {})
+        : alloc(alloc) { assign(il.begin(), il.end()); }
+
+    small_vector(const small_vector& other)
+        : alloc(alloc_traits::select_on_container_copy_construction(other.alloc))
+    {
+        assign(other.begin(), other.end());
+    }
+    small_vector(small_vector&& other) noexcept(std::is_nothrow_move_constructible<T>::value)
+        : alloc(std::move(other.alloc)) { take(other); }
+    small_vector(const small_vector& other, const allocator_type& alloc)
+        : alloc(alloc) { assign(other.begin(), other.end()); }
+    small_vector(small_vector&& other, const allocator_type& alloc)
+        : alloc(alloc)
+    {
+        if( alloc == other.alloc )
+            take(other);
+        else
+            assign(std::make_move_iterator(other.begin()), std::make_move_iterator(other.end()));
+    }
+
+    ~small_vector() { release(); }
+
+    small_vector& operator=(const small_vector& other)
+    {
+        if( &other != this )
+            assign(other.begin(), other.end());
+        return *this;
+    }
+    small_vector& operator=(small_vector&& other)
+    {
+        if( &other == this )
+            return *this;
+        if( alloc_traits::propagate_on_container_move_assignment::value || alloc == other.alloc ) {
+            release();
+            if( alloc_traits::propagate_on_container_move_assignment::value )
+                alloc = std::move(other.alloc);
+            take(other);
+        } else {
+            assign(std::make_move_iterator(other.begin()), std::make_move_iterator(other.end()));
+        }
+        return *this;
+    }
+    small_vector& operator=(std::initializer_list<T> il)
+    {
+        assign(il.begin(), il.end());
+        return *this;
+    }
+
+    template< typename InputIt >
+    void assign(InputIt first, InputIt last)
+    {
+        clear();
+        for( ; first != last; ++first )
+            push_back(*first);
+    }
+
+    iterator begin() { return first; }
+    iterator end() { return first + count; }
+    const_iterator begin() const { return cbegin(); }
+    const_iterator end() const { return cend(); }
+    const_iterator cbegin() const { return first; }
+    const_iterator cend() const { return first + count; }
+
+    bool empty() const { return count == 0; }
+    size_type size() const { return count; }
+
+    reference operator[] ( size_type n ) { return first[n]; }
+    const_reference operator[] ( size_type n ) const { return first[n]; }
+    reference at( size_type n ) { check_index(n); return first[n]; }
+    const_reference at( size_type n ) const { check_index(n); return first[n]; }
+    reference front() { return first[0]; }
+    const_reference front() const { return first[0]; }
+    reference back() { return first[count - 1]; }
+    const_reference back() const { return first[count - 1]; }
+
+    void push_back(const T& value) { emplace_back(value); }
+    void push_back(T&& value) { emplace_back(std::move(value)); }
+
+    template< typename... Args >
+    void emplace_back(Args&&... args)
+    {
+        if( count == cap ) {
+            // args may refer to an element, so the new one is constructed
+            // before the old ones are moved
+            const size_type n = next_capacity(count + 1);
+            T *target = alloc_traits::allocate(alloc, n);
+            try {
+                alloc_traits::construct(alloc, target + count, std::forward<Args>(args)...);
+            } catch( ... ) {
+                alloc_traits::deallocate(alloc, target, n);
+                throw;
+            }
+            try {
+                relocate(target, n);
+            } catch( ... ) {
+                alloc_traits::destroy(alloc, target + count);
+                alloc_traits::deallocate(alloc, target, n);
+                throw;
+            }
+        } else {
+            alloc_traits::construct(alloc, first + count, std::forward<Args>(args)...);
+        }
+        ++count;
+    }
+
+    void pop_back()
+    {
+        --count;
+        alloc_traits::destroy(alloc, first + count);
+    }
+
+    void clear() noexcept
+    {
+        for( size_type i = 0; i < count; ++i )
+            alloc_traits::destroy(alloc, first + i);
+        count = 0;
+    }
+
+    size_type capacity() const noexcept { return cap; }
+    void reserve(size_type n)
+    {
+        if( n > cap )
+            reallocate(next_capacity(n));
+    }
+
+    /// Moves spilled elements back into the object if they fit.
+    void shrink_to_fit()
+    {
+        if( is_spilled() && count <= N )
+            reallocate(N);
+    }
+
+    /// Whether the elements are stored outside of the object.
+    bool is_spilled() const { return first != inline_data(); }
+
+    allocator_type get_allocator() const { return alloc; }
+
+    friend bool operator==(const small_vector& lhs, const small_vector& rhs)
+    {
+        return lhs.size() == rhs.size() && std::equal(lhs.begin(), lhs.end(), rhs.begin());
+    }
+
+    friend bool operator!=(const small_vector& lhs, const small_vector& rhs)
+    {
+        return !(lhs == rhs);
+    }
+
+private:
+    T *inline_data() { return reinterpret_cast<T*>(storage); }
+    const T *inline_data() const { return reinterpret_cast<const T*>(storage); }
+
+    void check_index(size_type n) const
+    {
+        if( n >= count )
+            throw std::out_of_range("small_vector::at");
+    }
+
+    size_type next_capacity(size_type needed) const
+    {
+        if( ! Spill )
+            throw std::length_error("static_vector capacity exceeded");
+        return std::max(needed, 2 * cap);
+    }
+
+    // Moves the elements into storage for n elements, inline if n is N
+    void reallocate(size_type n)
+    {
+        T *target = n == N ? inline_data() : alloc_traits::allocate(alloc, n);
+        try {
+            relocate(target, n);
+        } catch( ... ) {
+            if( target != inline_data() )
+                alloc_traits::deallocate(alloc, target, n);
+            throw;
+        }
+    }
+
+    // Moves the elements into target, storage for n elements. The old
+    // elements are only destroyed once all are constructed in target; if
+    // that throws, the ones already constructed are destroyed again and the
+    // container is unchanged, releasing target is up to the caller.
+    void relocate(T *target, size_type n)
+    {
+        size_type i = 0;
+        try {
+            for( ; i < count; ++i )
+                alloc_traits::construct(alloc, target + i, std::move_if_noexcept(first[i]));
+        } catch( ... ) {
+            while( i > 0 )
+                alloc_traits::destroy(alloc, target + --i);
+            throw;
+        }
+        for( i = 0; i < count; ++i )
+            alloc_traits::destroy(alloc, first + i);
+        if( is_spilled() )
+            alloc_traits::deallocate(alloc, first, cap);
+        first = target;
+        cap = n;
+    }
+
+    void take(small_vector& other)
+    {
+        if( other.is_spilled() ) {
+            first = other.first;
+            cap = other.cap;
+            count = other.count;
+            other.first = other.inline_data();
+            other.cap = N;
+            other.count = 0;
+        } else {
+            for( size_type i = 0; i < other.count; ++i )
+                alloc_traits::construct(alloc, inline_data() + i, std::move(other.first[i]));
+            count = other.count;
+            other.clear();
+        }
+    }
+
+    void release()
+    {
+        clear();
+        if( is_spilled() )
+            alloc_traits::deallocate(alloc, first, cap);
+        first = inline_data();
+        cap = N;
+    }
+
+    allocator_type alloc;
+    size_type count = 0;
+    size_type cap = N;
+    T *first = inline_data();
+    typename std::aligned_storage<sizeof(T), alignof(T)>::type storage[N];
+};
+
+template< typename T, std::size_t N, class Alloc, bool Spill >
+constexpr typename small_vector<T, N, Alloc, Spill>::size_type small_vector<T, N, Alloc, Spill>::inline_capacity;
+template< typename T, std::size_t N, class Alloc, bool Spill >
+constexpr bool small_vector<T, N, Alloc, Spill>::spills;
+
+/// small_vector with the fixed capacity N, which never allocates.
+template< typename T, std::size_t N >
+using static_vector = small_vector<T, N, std::allocator<T>, false>;
+
+/// Heap storing up to N elements inline (see small_vector).
+template< typename T,
+          std::size_t N,
+          class Compare = std::less<T>,
+          class PositionTracker = position_tracker_nop,
+          std::size_t Arity = 2 >
+using small_heap = heap<T, Compare, PositionTracker, std::allocator<T>, Arity, small_vector<T, N>>;
+
+/// Heap of at most N elements without any allocation (see small_vector).
+template< typename T,
+          std::size_t N,
+          class Compare = std::less<T>,
+          class PositionTracker = position_tracker_nop,
+          std::size_t Arity = 2 >
+using static_heap = heap<T, Compare, PositionTracker, std::allocator<T>, Arity, static_vector<T, N>>;
+
+} // namespace binary_max_heap
+
+#endif // BINARY_MAX_HEAP_SMALL_VECTOR_H
@@ -0,0 +1,188 @@
+/* Copyright 2015 Zeno Sebastian Endemann <zeno.endemann@googlemail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the licence, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BINARY_MAX_HEAP_SPLIT_HEAP_H
+#define BINARY_MAX_HEAP_SPLIT_HEAP_H
+
+#include "binary_heap.h"
+
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+
+namespace binary_max_heap {
+
+/// Heap entry of split_heap: the key and the slot of its payload.
+template< typename Key, typename Index >
+struct split_heap_entry {
+    Key key;
+    Index slot;
+};
+
+/// Heap of (key, payload) pairs that stores keys and payloads separately
+/// ("struct of arrays"): the heap array only holds the keys plus a small
+/// payload index, the payloads live in a parallel array and never move.
+/// Sifting therefore compares and moves only small entries, which fits many
+/// more keys per cache line when the payload is large compared to the key.
+/// Payload slots are recycled through a free list.
+template< typename Key,
+          typename Payload,
+          class Compare = std::less<Key>,
+          std::size_t Arity = 2,
+          typename Index = std::uint32_t >
+class split_heap {
+public:
+    typedef Key                                             key_type;
+    typedef Payload                                         payload_type;
+    typedef split_heap_entry<Key, Index>                    entry_type;
+
+private:
+    struct entry_compare : private Compare {
+        entry_compare() = default;
+        entry_compare(const Compare& comp) : Compare(comp) {}
+
+        bool operator()(const entry_type& lhs, const entry_type& rhs) const
+        {
+            return Compare::operator()(lhs.key, rhs.key);
+        }
+
+        Compare key_compare() const { return *this; }
+    };
+
+    typedef heap<entry_type, entry_compare, position_tracker_nop,
+                 std::allocator<entry_type>, Arity>         heap_type;
+
+public:
+    typedef typename heap_type::const_iterator              const_iterator;
+    typedef typename heap_type::size_type                   size_type;
+
+    split_heap() = default;
+    explicit split_heap(const Compare& comp)
+        : h(typename heap_type::container_type(), entry_compare(comp)) {}
+
+    bool empty() const { return h.empty(); }
+    size_t size() const { return h.size(); }
+
+    const Key& top() const { return h.top().key; }
+    const Payload& top_payload() const { return payloads[h.top().slot]; }
+    Payload& top_payload() { return payloads[h.top().slot]; }
+
+    template< typename K, typename P >
+    void push(K&& key, P&& payload)
+    {
+        const Index slot = allocate_slot(std::forward<P>(payload));
+        h.push(entry_type{std::forward<K>(key), slot});
+    }
+
+    void pop() { erase(cbegin()); }
+
+    /// Removes the top element and returns its payload.
+    Payload pop_top() { return take(cbegin()); }
+
+    void erase(const_iterator position)
+    {
+        const Index slot = position->slot;
+        h.erase(position);
+        release_slot(slot);
+    }
+
+    Payload take(const_iterator position)
+    {
+        const Index slot = position->slot;
+        Payload p = std::move(payloads[slot]);
+        h.erase(position);
+        release_slot(slot);
+        return p;
+    }
+
+    /// Iteration is over the heap entries (in heap order); use key() and
+    /// payload() to access them.
+    const_iterator begin() const { return cbegin(); }
+    const_iterator end() const { return cend(); }
+    const_iterator cbegin() const { return h.cbegin(); }
+    const_iterator cend() const { return h.cend(); }
+
+    static const Key& key(const_iterator position) { return position->key; }
+    const Payload& payload(const_iterator position) const { return payloads[position->slot]; }
+    Payload& payload(const_iterator position) { return payloads[position->slot]; }
+
+    // Changing keys, see the corresponding heap functions
+
+    template< typename K >
+    void update(const_iterator position, K&& newKey)
+    {
+        h.update(position, entry_type{std::forward<K>(newKey), position->slot});
+    }
+
+    template< typename K >
+    void increase(const_iterator position, K&& newKey)
+    {
+        h.increase(position, entry_type{std::forward<K>(newKey), position->slot});
+    }
+
+    template< typename K >
+    void decrease(const_iterator position, K&& newKey)
+    {
+        h.decrease(position, entry_type{std::forward<K>(newKey), position->slot});
+    }
+
+    void clear() noexcept
+    {
+        h.clear();
+        payloads.clear();
+        freeSlots.clear();
+    }
+
+    void reserve(size_type n)
+    {
+        h.reserve(n);
+        payloads.reserve(n);
+    }
+
+    Compare compare() const { return h.compare().key_compare(); }
+
+private:
+    template< typename P >
+    Index allocate_slot(P&& payload)
+    {
+        if( ! freeSlots.empty() ) {
+            const Index slot = freeSlots.back();
+            freeSlots.pop_back();
+            payloads[slot] = std::forward<P>(payload);
+            return slot;
+        }
+
+        if( payloads.size() >= size_type(std::numeric_limits<Index>::max()) )
+            throw std::length_error("split_heap: payload index overflow");
+        payloads.push_back(std::forward<P>(payload));
+        return Index(payloads.size() - 1);
+    }
+
+    void release_slot(const Index slot)
+    {
+        payloads[slot] = Payload();
+        freeSlots.push_back(slot);
+    }
+
+    heap_type h;
+    std::vector<Payload> payloads;
+    std::vector<Index> freeSlots;
+};
+
+} // namespace binary_max_heap
+
+#endif // BINARY_MAX_HEAP_SPLIT_HEAP_H
@@ -10,7 +10,20 @@ TEMPLATE = app
 
 
 SOURCES += tst_binaryheaptest.cpp
-HEADERS += ../binary_heap.h
+HEADERS += lcg.h \
+    ../binary_heap.h \
+    ../split_heap.h \
+    ../handle_heap.h \
+    ../concurrent_heap.h \
+    ../multi_queue.h \
+    ../radix_heap.h \
+    ../buffered_heap.h \
+    ../external_heap.h \
+    ../mapped_vector.h \
+    ../journaled_heap.h \
+    ../segmented_vector.h \
+    ../small_vector.h \
+    ../checksum.h
 INCLUDEPATH += ..
 
 DEFINES += SRCDIR=\\\"$$PWD/\\\"
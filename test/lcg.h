@@ -0,0 +1,23 @@
+#ifndef LCG_H
+#define LCG_H
+
+#include <cstdint>
+
+// Deterministic pseudo random numbers (Knuth's MMIX LCG), the same on every
+// platform, shared by the tests and the benchmark; the low bits are weak, so
+// values are taken from the high ones
+class Lcg {
+public:
+    explicit Lcg(uint64_t seed = 4711) : state(seed) {}
+
+    uint64_t operator()()
+    {
+        state = state * 6364136223846793005ull + 1442695040888963407ull;
+        return state;
+    }
+
+private:
+    uint64_t state;
+};
+
+#endif // LCG_H
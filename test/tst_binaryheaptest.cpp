@@ -3,28 +3,49 @@
 #include <QDebug>
 
 #include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <queue>
+#include <thread>
 
 #include "binary_heap.h"
+#include "split_heap.h"
+#include "handle_heap.h"
+#include "concurrent_heap.h"
+#include "multi_queue.h"
+#include "radix_heap.h"
+#include "buffered_heap.h"
+#include "external_heap.h"
+#include "mapped_vector.h"
+#include "journaled_heap.h"
+#include "segmented_vector.h"
+#include "small_vector.h"
+#include "lcg.h"
 
 template class binary_max_heap::heap< int >;
+template class binary_max_heap::heap< int, std::less<int>, binary_max_heap::position_tracker_nop, std::allocator<int>, 4 >;
+template class binary_max_heap::cache_aligned_vector< int, 4 >;
+template class binary_max_heap::segmented_vector< int, 8 >;
+template class binary_max_heap::small_vector< int, 8 >;
+template class binary_max_heap::small_vector< int, 8, std::allocator<int>, false >;
 
 
 template<typename DiffType>
-DiffType heapFirstChild(DiffType pos)
+DiffType heapFirstChild(DiffType pos, DiffType arity = 2)
 {
-    return 2 * pos + 1;
+    return arity * pos + 1;
 }
 
 template<typename DiffType>
-DiffType heapSecondChild(DiffType pos)
+DiffType heapSecondChild(DiffType pos, DiffType arity = 2)
 {
-    return 2 * pos + 2;
+    return arity * pos + 2;
 }
 
 template<typename DiffType>
-DiffType heapParent(DiffType pos)
+DiffType heapParent(DiffType pos, DiffType arity = 2)
 {
-    return (pos - 1) / 2;
+    return (pos - 1) / arity;
 }
 
 template<class Heap>
@@ -35,7 +56,7 @@ bool isBinaryHeap(const Heap& h)
     const auto comp = h.compare();
 
     for( auto i = n > 0 ? n - 1 : 0; i > 0; --i ) {
-        const auto parent = heapParent(i);
+        const auto parent = Heap::layout_type::parent_index(i);
         if( comp(*(first + parent), *(first + i)) ) {
             qWarning() << "Heap property violated at" << i << "( size" << n << ")";
             return false;
@@ -51,7 +72,7 @@ bool checkedPush(Heap& h, U&& value)
 {
     const auto comp = h.compare();
 
-    auto c_old = h.container();
+    std::vector<typename Heap::value_type> c_old(h.cbegin(), h.cend());
     c_old.push_back(value);
     std::sort(c_old.begin(), c_old.end(), comp);
 
@@ -60,7 +81,7 @@ bool checkedPush(Heap& h, U&& value)
     if( ! isBinaryHeap(h) )
         return false;
 
-    auto c_new = h.container();
+    std::vector<typename Heap::value_type> c_new(h.cbegin(), h.cend());
     std::sort(c_new.begin(), c_new.end(), comp);
 
     return c_old == c_new;
@@ -72,7 +93,7 @@ bool checkedPop(Heap& h)
 {
     const auto comp = h.compare();
 
-    auto c_old = h.container();
+    std::vector<typename Heap::value_type> c_old(h.cbegin(), h.cend());
     c_old.erase(c_old.begin());
     std::sort(c_old.begin(), c_old.end(), comp);
 
@@ -81,7 +102,7 @@ bool checkedPop(Heap& h)
     if( ! isBinaryHeap(h) )
         return false;
 
-    auto c_new = h.container();
+    std::vector<typename Heap::value_type> c_new(h.cbegin(), h.cend());
     std::sort(c_new.begin(), c_new.end(), comp);
 
     return c_old == c_new;
@@ -143,6 +164,56 @@ public:
     static void remove(const Heap& /*heap*/, const T& /*value*/, DiffType /*position*/) {}
 };
 
+struct TestNode {
+    bool operator< (const TestNode &rhs) const
+    {
+        return key < rhs.key;
+    }
+
+    int key = 0;
+    int heapIndex = -1;
+};
+
+struct TestNodePtrLess {
+    bool operator()(const std::unique_ptr<TestNode>& lhs, const std::unique_ptr<TestNode>& rhs) const
+    {
+        return *lhs < *rhs;
+    }
+};
+
+typedef binary_max_heap::intrusive_position_tracker<TestNode, int, &TestNode::heapIndex> TestNodeTracker;
+
+// std::less<int> that throws at the s_compareThrowIn-th call from now on
+int s_compareThrowIn = 0;
+struct ThrowingLess {
+    bool operator()(int lhs, int rhs) const
+    {
+        if( s_compareThrowIn > 0 && --s_compareThrowIn == 0 )
+            throw std::runtime_error("compare");
+        return lhs < rhs;
+    }
+};
+
+// String whose copy constructor throws at the s_copyThrowIn-th call from now
+// on; its move constructor may throw too, so containers copy it when growing
+int s_copyThrowIn = 0;
+struct ThrowingCopy {
+    ThrowingCopy(const char *s) : s(s) {}
+    ThrowingCopy(const ThrowingCopy& other) : s(other.s)
+    {
+        if( s_copyThrowIn > 0 && --s_copyThrowIn == 0 )
+            throw std::runtime_error("copy");
+    }
+    ThrowingCopy(ThrowingCopy&& other) : s(std::move(other.s)) {}
+    ThrowingCopy& operator=(const ThrowingCopy&) = default;
+
+    std::string s;
+};
+
+// heap::erase(const T&) and heap::update(const T&, U&&) only exist with a tracker providing position()
+static_assert(binary_max_heap::tracks_positions<TestNodeTracker, TestNode>::value, "");
+static_assert(! binary_max_heap::tracks_positions<binary_max_heap::position_tracker_nop, TestNode>::value, "");
+
 template<class Heap>
 bool checkPosition(const Heap& h)
 {
@@ -206,6 +277,1189 @@ private Q_SLOTS:
 
         QVERIFY(h.empty());
     }
+
+    void testCase3()
+    {
+        using namespace binary_max_heap;
+        testOperations<heap<int, std::less<int>, position_tracker_nop, std::allocator<int>, 3>>();
+        testOperations<heap<int, std::less<int>, position_tracker_nop, std::allocator<int>, 4>>();
+        testOperations<heap<int, std::less<int>, position_tracker_nop, std::allocator<int>, 8>>();
+    }
+
+    void testCase4()
+    {
+        using namespace binary_max_heap;
+        testOperations<cache_aligned_heap<int>>();
+        testOperations<cache_aligned_heap<int, std::less<int>, position_tracker_nop, 16>>();
+
+        // Each sibling group of 16 ints fills exactly one cache line
+        cache_aligned_heap<int, std::less<int>, position_tracker_nop, 16> h;
+        QVERIFY(h.capacity() == 0);
+        for( int i = 0; i < 1000; ++i )
+            h.push(i);
+        for( std::size_t i = 0; i < 1000; i += 16 )
+            QVERIFY(reinterpret_cast<std::uintptr_t>(&h[i + 1]) % 64 == 0);
+
+        auto h2 = std::move(h);
+        QVERIFY(h2.size() == 1000 && h.empty());
+        h.push(3);
+        QVERIFY(h.size() == 1 && h.top() == 3);
+
+        // taking the container leaves an empty one without the padding slots
+        // (no allocation, so the array pointer is null)
+        auto taken = h2.take_container();
+        QVERIFY(taken.size() == 1000 && h2.empty() && h2.cbegin() == nullptr);
+        cache_aligned_vector<int, 16> v{1, 2};
+        v = {};
+        v.assign(taken.begin(), taken.begin());
+        QVERIFY(v.empty() && v.size() == 0 && v.cbegin() == v.cend());
+    }
+
+    void testCase5()
+    {
+        using namespace binary_max_heap;
+        testLayout<d_ary_layout<2>>();
+        testLayout<d_ary_layout<4>>();
+        testLayout<b_heap_layout<2, 2>>();
+        testLayout<b_heap_layout<2, 4>>();
+        testLayout<b_heap_layout<3, 3>>();
+
+        for( long i = 0; i < 1000; ++i ) {
+            QVERIFY(d_ary_layout<2>::parent_index(i + 1) == heapParent(i + 1));
+            QVERIFY(d_ary_layout<2>::first_child_index(i) == heapFirstChild(i));
+            QVERIFY(d_ary_layout<4>::first_child_index(i) == heapFirstChild(i, 4l));
+        }
+
+        typedef std::vector<int> Vec;
+        testOperations<heap<int, std::less<int>, position_tracker_nop, std::allocator<int>, 2, Vec, b_heap_layout<2, 2>>>();
+        testOperations<heap<int, std::less<int>, position_tracker_nop, std::allocator<int>, 2, Vec, b_heap_layout<2, 3>>>();
+        testOperations<heap<int, std::less<int>, position_tracker_nop, std::allocator<int>, 4, Vec, b_heap_layout<4, 2>>>();
+        testOperations<b_heap<int>>();
+
+        b_heap<TestValue, std::less<TestValue>, binary_heap_TestValue_position_tracker, 64> h;
+        for( int i = 0; i < 500; ++i ) {
+            h.push((i * 97) % 503);
+            QVERIFY(checkPosition(h));
+        }
+        QVERIFY(isBinaryHeap(h));
+        for( int i = 0; i < 500; ++i ) {
+            h.pop();
+            QVERIFY(checkPosition(h));
+        }
+    }
+
+    void testCase6()
+    {
+        // Children selection for arithmetic types (vectorized if enabled)
+        testArithmetic<double, std::less<double>, 4>();
+        testArithmetic<double, std::greater<double>, 8>();
+        testArithmetic<float, std::less<float>, 8>();
+        testArithmetic<float, std::greater<float>, 4>();
+        testArithmetic<int32_t, std::less<int32_t>, 4>();
+        testArithmetic<int32_t, std::greater<int32_t>, 8>();
+        testArithmetic<int64_t, std::less<int64_t>, 8>();
+        testArithmetic<int64_t, std::greater<int64_t>, 4>();
+    }
+
+    void testCase7()
+    {
+        binary_max_heap::split_heap<int, std::string, std::greater<int>, 4> h;
+
+        for( int i = 0; i < 200; ++i )
+            h.push((i * 37) % 101, std::to_string(i));
+
+        // payloads follow their keys
+        for( auto it = h.cbegin(); it != h.cend(); ++it )
+            QVERIFY((std::stoi(h.payload(it)) * 37) % 101 == h.key(it));
+
+        for( int i = 0; i < 50; ++i ) {
+            const auto it = h.cbegin() + (i * 13) % h.size();
+            h.payload(it) += "x";
+            h.update(it, h.key(it) + 1000);
+            h.erase(h.cbegin() + (i * 7) % h.size());
+        }
+
+        int last = h.top();
+        std::size_t updated = 0;
+        while( ! h.empty() ) {
+            QVERIFY(h.top() >= last);
+            last = h.top();
+            const std::string p = h.top_payload();
+            const int updates = std::count(p.begin(), p.end(), 'x');
+            QVERIFY((std::stoi(p) * 37) % 101 + 1000 * updates == last);
+            updated += updates;
+            h.pop();
+        }
+        QVERIFY(updated > 0);
+
+        // freed payload slots are reused
+        h.push(1, "a");
+        h.push(2, "b");
+        QVERIFY(h.pop_top() == "a");
+        QVERIFY(h.top_payload() == "b");
+    }
+
+    void testCase8()
+    {
+        typedef binary_max_heap::handle_heap<int, std::less<int>, 3> Heap;
+        Heap h;
+        std::vector<Heap::handle> handles;
+        std::vector<int> values;
+
+        for( int i = 0; i < 200; ++i ) {
+            values.push_back((i * 37) % 101);
+            handles.push_back(h.push(values.back()));
+        }
+
+        for( int i = 0; i < 200; ++i )
+            QVERIFY(h.contains(handles[i]) && h.value(handles[i]) == values[i]);
+        QVERIFY(h.value(h.top_handle()) == h.top());
+
+        for( int i = 0; i < 200; i += 3 ) {
+            values[i] += (i % 2) ? 50 : -50;
+            if( i % 2 )
+                h.increase(handles[i], values[i]);
+            else
+                h.decrease(handles[i], values[i]);
+        }
+        for( int i = 1; i < 200; i += 5 ) {
+            values[i] = 100 - values[i];
+            h.update(handles[i], values[i]);
+        }
+        for( int i = 2; i < 200; i += 7 ) {
+            h.erase(handles[i]);
+            QVERIFY(! h.contains(handles[i]));
+        }
+
+        for( int i = 0; i < 200; ++i ) {
+            if( h.contains(handles[i]) )
+                QVERIFY(h.value(handles[i]) == values[i]);
+        }
+
+        int last = h.top();
+        while( ! h.empty() ) {
+            QVERIFY(h.top() <= last);
+            const Heap::handle top = h.top_handle();
+            last = h.top();
+            QVERIFY(h.pop_top() == values[top.index]);
+            QVERIFY(! h.contains(top));
+        }
+
+        // reused slots get a new generation, stale handles stay invalid
+        const Heap::handle a = h.push(1);
+        QVERIFY(a != handles[a.index]);
+        QVERIFY(h.contains(a) && h.take(a) == 1);
+
+        h.push(5);
+        h.clear();
+        QVERIFY(h.empty() && ! h.contains(handles[0]));
+    }
+
+    void testCase9()
+    {
+        // positions stored in the elements
+        binary_max_heap::heap<TestNode, std::less<TestNode>, TestNodeTracker> h;
+        for( int i = 0; i < 100; ++i ) {
+            TestNode n;
+            n.key = (i * 37) % 101;
+            h.push(n);
+        }
+        for( int i = 0; i < 100; ++i )
+            QVERIFY(h.at(i).heapIndex == i);
+
+        TestNode n = h.at(42);
+        n.key += 1000;
+        h.update(h.at(42), n);
+        QVERIFY(h.top().key == n.key && h.top().heapIndex == 0);
+        h.erase(h.at(17));
+        QVERIFY(isBinaryHeap(h) && h.size() == 99);
+        for( int i = 0; i < 99; ++i )
+            QVERIFY(h.at(i).heapIndex == i);
+
+        // positions stored in the pointees
+        typedef binary_max_heap::heap<std::unique_ptr<TestNode>, TestNodePtrLess, TestNodeTracker,
+                                      std::allocator<std::unique_ptr<TestNode> >, 4> PtrHeap;
+        PtrHeap p;
+        std::vector<TestNode*> nodes;
+        for( int i = 0; i < 100; ++i ) {
+            std::unique_ptr<TestNode> node(new TestNode);
+            node->key = (i * 37) % 101;
+            nodes.push_back(node.get());
+            p.push(std::move(node));
+        }
+
+        for( int i = 0; i < 100; i += 3 ) {
+            const std::unique_ptr<TestNode>& node = p.at(nodes[i]->heapIndex);
+            QVERIFY(node.get() == nodes[i]);
+            if( i % 2 ) {
+                p.erase(node);
+                nodes[i] = nullptr;
+            } else {
+                std::unique_ptr<TestNode> updated(new TestNode);
+                updated->key = 100 - nodes[i]->key;
+                nodes[i] = updated.get();
+                p.update(node, std::move(updated));
+            }
+        }
+        QVERIFY(isBinaryHeap(p) && p.size() == 83);
+        for( TestNode *node : nodes ) {
+            if( node )
+                QVERIFY(p.at(node->heapIndex).get() == node);
+        }
+
+        int last = p.top()->key;
+        while( ! p.empty() ) {
+            QVERIFY(p.top()->key <= last);
+            last = p.top()->key;
+            std::unique_ptr<TestNode> top = p.pop_top();
+            QVERIFY(top->heapIndex == TestNodeTracker::npos);
+        }
+    }
+
+    void testCase10()
+    {
+        binary_max_heap::heap<int, std::greater<int>, binary_max_heap::position_tracker_nop,
+                              std::allocator<int>, 4> h;
+        for( int i = 0; i < 100; ++i )
+            h.push((i * 37) % 101);
+
+        // replace_top / push_pop
+        h.replace_top(-5);
+        QVERIFY(h.top() == -5 && isBinaryHeap(h) && h.size() == 100);
+        h.replace_top(500);
+        QVERIFY(h.top() == 1 && isBinaryHeap(h));
+        QVERIFY(h.push_pop(-10) == -10 && h.size() == 100);
+        QVERIFY(h.push_pop(1000) == 1 && h.top() == 2 && isBinaryHeap(h) && h.size() == 100);
+
+        // drain_while
+        std::vector<int> drained;
+        h.drain_while([] (int v) { return v < 20; }, std::back_inserter(drained));
+        QVERIFY(std::is_sorted(drained.begin(), drained.end()) && drained.size() == 18);
+        QVERIFY(h.top() >= 20 && isBinaryHeap(h));
+
+        // reschedule_while, like timers of the same tick
+        const int t = h.top();
+        const auto count = h.reschedule_while([t] (int v) { return v == t; },
+                                              [] (int& v) { v += 1000; });
+        QVERIFY(count == 1 && h.top() > t && isBinaryHeap(h) && h.size() == 82);
+
+        for( int i = 0; i < 10; ++i )
+            h.push(7);
+        QVERIFY(h.reschedule_while([] (int v) { return v < 10; }, [] (int& v) { v += 100; }) == 10);
+        QVERIFY(std::count(h.cbegin(), h.cend(), 107) == 10 && isBinaryHeap(h));
+
+        h.clear();
+        QVERIFY(h.push_pop(3) == 3 && h.empty());
+        QVERIFY(h.reschedule_while([] (int) { return true; }, [] (int&) {}) == 0);
+    }
+
+    void testCase11()
+    {
+        // push_range notifies the position tracker and can move elements
+        typedef binary_max_heap::heap<std::unique_ptr<TestNode>, TestNodePtrLess, TestNodeTracker,
+                                      std::allocator<std::unique_ptr<TestNode> >, 4> PtrHeap;
+
+        for( int n : {0, 5, 100, 300} ) {
+            for( int k : {1, 10, 1000} ) {
+                PtrHeap h;
+                std::vector<std::unique_ptr<TestNode> > nodes;
+                for( int i = 0; i < n + k; ++i ) {
+                    nodes.emplace_back(new TestNode);
+                    nodes.back()->key = (i * 37) % 1009;
+                }
+
+                h.push_range(std::make_move_iterator(nodes.begin()), std::make_move_iterator(nodes.begin() + n));
+                h.push_range(std::make_move_iterator(nodes.begin() + n), std::make_move_iterator(nodes.end()));
+                QVERIFY(isBinaryHeap(h) && h.size() == std::size_t(n + k));
+                QVERIFY(std::none_of(nodes.begin(), nodes.end(), [] (const std::unique_ptr<TestNode>& p) { return bool(p); }));
+
+                for( std::size_t i = 0; i < h.size(); ++i )
+                    QVERIFY(h.at(i)->heapIndex == int(i));
+            }
+        }
+    }
+
+    void testCase12()
+    {
+        // merge notifies both position trackers
+        typedef binary_max_heap::heap<std::unique_ptr<TestNode>, TestNodePtrLess, TestNodeTracker,
+                                      std::allocator<std::unique_ptr<TestNode> >, 4> PtrHeap;
+
+        for( int n : {0, 3, 50, 400} ) {
+            for( int k : {0, 4, 60, 500} ) {
+                PtrHeap a, b;
+                std::vector<TestNode*> nodes;
+                for( int i = 0; i < n + k; ++i ) {
+                    std::unique_ptr<TestNode> node(new TestNode);
+                    node->key = (i * 37) % 1009;
+                    nodes.push_back(node.get());
+                    (i < n ? a : b).push(std::move(node));
+                }
+
+                a.merge(std::move(b));
+                QVERIFY(isBinaryHeap(a) && b.empty() && a.size() == std::size_t(n + k));
+                for( TestNode *node : nodes )
+                    QVERIFY(a.at(node->heapIndex).get() == node);
+            }
+        }
+    }
+
+    void testCase13()
+    {
+        // erase_if notifies the position tracker
+        binary_max_heap::heap<TestNode, std::less<TestNode>, TestNodeTracker> h;
+        for( int i = 0; i < 500; ++i ) {
+            TestNode n;
+            n.key = (i * 37) % 1009;
+            h.push(n);
+        }
+
+        for( int m : {2, 5, 3} ) {
+            const std::size_t before = h.size();
+            const auto removed = h.erase_if([m] (const TestNode &n) { return n.key % m == 0; });
+            QVERIFY(isBinaryHeap(h) && h.size() == before - removed && removed > 0);
+            for( std::size_t i = 0; i < h.size(); ++i )
+                QVERIFY(h.at(i).heapIndex == int(i) && h.at(i).key % m != 0);
+        }
+        QVERIFY(h.erase_if([] (const TestNode &) { return false; }) == 0);
+
+        // pred is called once per element
+        binary_max_heap::heap<int> plain({5, 3, 8, 1, 9, 2});
+        int calls = 0;
+        plain.erase_if([&calls] (int v) { ++calls; return v % 2 == 1; });
+        QVERIFY(calls == 6 && plain.size() == 2 && isBinaryHeap(plain));
+    }
+
+    void testCase14()
+    {
+        // update_batch on handles, keeping the position tracker up to date
+        typedef binary_max_heap::handle_heap<int, std::greater<int>, 4> Heap;
+        Heap h;
+        std::vector<Heap::handle> handles;
+        std::vector<int> values;
+        for( int i = 0; i < 400; ++i ) {
+            values.push_back((i * 37) % 401);
+            handles.push_back(h.push(values.back()));
+        }
+
+        for( int count : {2, 40, 400} ) {
+            Heap::update_batch batch(h);
+            for( int i = 0; i < count; ++i ) {
+                const int k = (i * 97) % 400;
+                values[k] = (i * 13) % 1000 - 300;
+                batch.update(handles[k], values[k]);
+            }
+            QVERIFY(batch.top() == *std::min_element(values.begin(), values.end()));
+
+            for( int k = 0; k < 400; ++k )
+                QVERIFY(h.value(handles[k]) == values[k]);
+        }
+
+        int last = h.top();
+        while( ! h.empty() ) {
+            QVERIFY(h.top() >= last);
+            last = h.pop_top();
+        }
+
+        // a failing repair in the destructor is swallowed, and the heap rebuilt
+        binary_max_heap::heap<int, ThrowingLess> t({1, 2, 3, 4, 5, 6, 7, 8});
+        {
+            binary_max_heap::heap<int, ThrowingLess>::update_batch batch(t);
+            batch.update(t.cbegin() + 7, 100);
+            batch.update(t.cbegin() + 3, 50);
+            s_compareThrowIn = 1;
+        }
+        QVERIFY(s_compareThrowIn == 0 && isBinaryHeap(t) && t.top() == 100);
+
+        // the same for handles, with a lazily erased element getting on top
+        typedef binary_max_heap::handle_heap<int, ThrowingLess> ThrowingHeap;
+        ThrowingHeap th;
+        std::vector<ThrowingHeap::handle> thHandles;
+        for( int i = 1; i <= 8; ++i )
+            thHandles.push_back(th.push(i));
+        th.lazy_erase(thHandles[6]);
+        {
+            ThrowingHeap::update_batch batch(th);
+            batch.update(thHandles[7], 0);
+            s_compareThrowIn = 1;
+        }
+        QVERIFY(s_compareThrowIn == 0 && th.size() == 7 && th.top() == 6 && th.value(thHandles[7]) == 0);
+    }
+
+    void testCase15()
+    {
+        using namespace binary_max_heap;
+
+        testParallelBuild<heap<int>>();
+        testParallelBuild<heap<int, std::less<int>, position_tracker_nop, std::allocator<int>, 3>>();
+        testParallelBuild<heap<int, std::greater<int>, position_tracker_nop, std::allocator<int>, 4>>();
+        testParallelBuild<b_heap<int>>();
+
+        // the position tracker is informed about every element
+        std::vector<TestNode> nodes(300000);
+        for( std::size_t i = 0; i < nodes.size(); ++i )
+            nodes[i].key = int((i * 7919) % 300007);
+        heap<TestNode, std::less<TestNode>, TestNodeTracker> h(std::move(nodes), build_threads(4));
+        QVERIFY(isBinaryHeap(h));
+        for( std::size_t i = 0; i < h.size(); ++i )
+            QVERIFY(h.at(i).heapIndex == int(i));
+    }
+
+    void testCase16()
+    {
+        binary_max_heap::concurrent_heap<int> h(500);
+        for( int i = 0; i < 500; ++i )
+            QVERIFY(h.push((i * 37) % 503));
+        QVERIFY(! h.push(1) && h.size() == 500);
+
+        int last = std::numeric_limits<int>::max(), v;
+        while( h.try_pop(v) ) {
+            QVERIFY(v <= last);
+            last = v;
+        }
+        QVERIFY(h.empty() && ! h.try_pop(v));
+
+        // concurrent pushes and pops neither lose nor duplicate elements
+        const int threadCount = 4, perThread = 10000;
+        binary_max_heap::concurrent_heap<int> c(threadCount * perThread);
+        std::vector<std::vector<int>> popped(threadCount);
+        std::vector<std::thread> threads;
+        for( int t = 0; t < threadCount; ++t ) {
+            threads.emplace_back([&c, &popped, t] {
+                for( int i = 0; i < perThread; ++i ) {
+                    c.push(t * perThread + i);
+                    int x;
+                    if( i % 2 && c.try_pop(x) )
+                        popped[t].push_back(x);
+                }
+            });
+        }
+        for( auto &t : threads )
+            t.join();
+
+        std::vector<int> all;
+        for( const auto &p : popped )
+            all.insert(all.end(), p.begin(), p.end());
+        last = std::numeric_limits<int>::max();
+        while( c.try_pop(v) ) {
+            QVERIFY(v <= last);
+            last = v;
+            all.push_back(v);
+        }
+        std::sort(all.begin(), all.end());
+        QVERIFY(int(all.size()) == threadCount * perThread);
+        for( int i = 0; i < threadCount * perThread; ++i )
+            QVERIFY(all[i] == i);
+    }
+
+    void testCase17()
+    {
+        binary_max_heap::multi_queue<int, std::greater<int>> q(4);
+        QVERIFY(q.shard_count() == 8 && q.empty());
+        for( int i = 0; i < 1000; ++i )
+            q.push((i * 37) % 1000);
+        QVERIFY(q.size() == 1000);
+
+        // relaxed order, but every element comes out exactly once
+        std::vector<int> all;
+        int v;
+        while( q.try_pop(v) )
+            all.push_back(v);
+        QVERIFY(q.empty());
+        std::sort(all.begin(), all.end());
+        QVERIFY(all.size() == 1000);
+        for( int i = 0; i < 1000; ++i )
+            QVERIFY(all[i] == i);
+
+        const int threadCount = 4, perThread = 10000;
+        binary_max_heap::multi_queue<int> c(threadCount);
+        std::vector<std::vector<int>> popped(threadCount);
+        std::vector<std::thread> threads;
+        for( int t = 0; t < threadCount; ++t ) {
+            threads.emplace_back([&c, &popped, t] {
+                for( int i = 0; i < perThread; ++i ) {
+                    c.push(t * perThread + i);
+                    int x;
+                    if( i % 2 && c.try_pop(x) )
+                        popped[t].push_back(x);
+                }
+            });
+        }
+        for( auto &t : threads )
+            t.join();
+
+        all.clear();
+        for( const auto &p : popped )
+            all.insert(all.end(), p.begin(), p.end());
+        while( c.try_pop(v) )
+            all.push_back(v);
+        std::sort(all.begin(), all.end());
+        QVERIFY(int(all.size()) == threadCount * perThread);
+        for( int i = 0; i < threadCount * perThread; ++i )
+            QVERIFY(all[i] == i);
+    }
+
+    void testCase18()
+    {
+        // monotone workload, compared to a min priority_queue
+        binary_max_heap::radix_heap<uint64_t> h;
+        std::priority_queue<uint64_t, std::vector<uint64_t>, std::greater<uint64_t>> ref;
+        Lcg rng;
+        for( int i = 0; i < 20000; ++i ) {
+            const uint64_t state = rng();
+            const uint64_t last = h.empty() ? h.last_key() : h.top();
+            const uint64_t v = last + (state >> (20 + i % 40));
+            h.push(v);
+            ref.push(v);
+            if( i % 3 == 0 ) {
+                QVERIFY(h.top() == ref.top());
+                QVERIFY(h.pop_top() == ref.top());
+                ref.pop();
+            }
+            QVERIFY(h.size() == ref.size());
+        }
+        while( ! ref.empty() ) {
+            QVERIFY(h.top() == ref.top());
+            h.pop();
+            ref.pop();
+        }
+        QVERIFY(h.empty());
+
+        // keys below the last minimum are rejected
+        const uint64_t minKey = h.last_key();
+        bool thrown = false;
+        try {
+            h.push(minKey - 1);
+        } catch( const std::invalid_argument& ) {
+            thrown = true;
+        }
+        QVERIFY(thrown && h.empty() && h.last_key() == minKey);
+
+        // keys given by KeyOf, and equal keys
+        struct KeyOf {
+            uint32_t operator()(const std::pair<uint32_t, int> &v) const { return v.first; }
+        };
+        binary_max_heap::radix_heap<std::pair<uint32_t, int>, KeyOf> p;
+        for( int i = 0; i < 300; ++i )
+            p.push(std::make_pair(uint32_t((i * 37) % 100), i));
+        uint32_t lastKey = 0;
+        int count = 0;
+        while( ! p.empty() ) {
+            const auto v = p.pop_top();
+            QVERIFY(v.first >= lastKey && int(v.first) == (v.second * 37) % 100);
+            lastKey = v.first;
+            ++count;
+        }
+        QVERIFY(count == 300);
+    }
+
+    void testCase19()
+    {
+        typedef binary_max_heap::handle_heap<int> Heap;
+        Heap h;
+        h.set_max_dead_fraction(0.75);
+        std::vector<Heap::handle> handles;
+        for( int i = 0; i < 1000; ++i )
+            handles.push_back(h.push((i * 37) % 1000));
+
+        // erase the multiples of 3 lazily, including the top
+        std::vector<bool> erased(1000, false);
+        for( int i = 0; i < 1000; i += 3 ) {
+            h.lazy_erase(handles[i]);
+            erased[i] = true;
+            QVERIFY(! h.contains(handles[i]));
+        }
+        QVERIFY(h.size() == 666 && h.physical_size() > h.size());
+        QVERIFY(! erased[(std::find(handles.begin(), handles.end(), h.top_handle()) - handles.begin())]);
+
+        // lowering elements must not uncover erased ones
+        for( int i = 1; i < 1000; i += 3 )
+            h.decrease(handles[i], -i);
+        const auto physical = h.physical_size();
+        int last = h.top();
+        std::size_t popped = 0;
+        while( h.top() >= 0 ) {
+            QVERIFY(h.top() <= last);
+            last = h.pop_top();
+            ++popped;
+        }
+        QVERIFY(popped == 333 && h.size() == 333 && h.physical_size() <= physical - popped);
+
+        // compaction once the dead fraction exceeds the threshold
+        for( int i = 1; i < 600; i += 3 )
+            h.lazy_erase(handles[i]);
+        QVERIFY(h.size() == 133 && h.physical_size() < 4 * h.size());
+        h.compact();
+        QVERIFY(h.physical_size() == h.size());
+        last = h.top();
+        while( ! h.empty() ) {
+            QVERIFY(h.top() <= last);
+            last = h.pop_top();
+        }
+        QVERIFY(h.physical_size() == 0);
+
+        // released slots are reused with new generations
+        const Heap::handle hd = h.push(5);
+        QVERIFY(h.contains(hd) && h.value(hd) == 5);
+        h.lazy_erase(hd);
+        QVERIFY(h.empty() && ! h.contains(hd));
+    }
+
+    void testCase20()
+    {
+        testBuffered<binary_max_heap::buffered_heap<int, std::less<int>, 4>>();
+        testBuffered<binary_max_heap::buffered_heap<int, std::greater<int>, 64, 4>>();
+        testBuffered<binary_max_heap::buffered_heap<int>>();
+    }
+
+    void testCase21()
+    {
+        // budgets small enough for many runs and merges of them
+        for( std::size_t budget : {std::size_t(64), std::size_t(4096)} ) {
+            binary_max_heap::external_heap<int> h(budget * sizeof(int));
+            std::priority_queue<int> ref;
+            Lcg rng;
+            for( int i = 0; i < 20000; ++i ) {
+                const uint64_t state = rng();
+                const int v = int((state >> 33) % 100000);
+                h.push(v);
+                ref.push(v);
+                if( (state >> 20) % 4 == 0 ) {
+                    QVERIFY(h.top() == ref.top());
+                    QVERIFY(h.pop_top() == ref.top());
+                    ref.pop();
+                }
+                QVERIFY(h.size() == ref.size());
+            }
+            QVERIFY(h.run_count() > 0 && h.run_count() <= h.max_runs);
+            while( ! ref.empty() ) {
+                QVERIFY(h.top() == ref.top());
+                h.pop();
+                ref.pop();
+            }
+            QVERIFY(h.empty() && h.run_count() == 0);
+        }
+
+        // 20000 elements in runs of 32 need four levels of runs
+        binary_max_heap::external_heap<int> l(64 * sizeof(int));
+        for( int i = 0; i < 20000; ++i )
+            l.push((i * 7919) % 20000);
+        QVERIFY(l.run_count() <= 4 * l.merge_width);
+        for( int i = 19999; i >= 0; --i )
+            QVERIFY(l.pop_top() == i);
+
+        binary_max_heap::external_heap<int, std::greater<int>> g(16 * sizeof(int));
+        for( int i = 0; i < 1000; ++i )
+            g.push((i * 37) % 1000);
+        for( int i = 0; i < 1000; ++i )
+            QVERIFY(g.pop_top() == i);
+    }
+
+    void testCase22()
+    {
+        typedef binary_max_heap::mapped_vector<int64_t> Vector;
+        typedef binary_max_heap::mapped_heap<int64_t> Heap;
+
+        QTemporaryDir dir;
+        QVERIFY(dir.isValid());
+        const std::string path = (dir.path() + "/heap.map").toStdString();
+
+        // grows over several extents
+        std::vector<int64_t> ref;
+        {
+            Heap h(Vector(path, 7), binary_max_heap::assume_heap);
+            QVERIFY(h.empty());
+            for( int64_t i = 0; i < 300000; ++i ) {
+                const int64_t v = (i * 7919) % 300007;
+                h.push(v);
+                ref.push_back(v);
+            }
+            for( int i = 0; i < 1000; ++i )
+                h.pop();
+            QVERIFY(h.size() == 299000 && isBinaryHeap(h));
+        }
+        std::sort(ref.begin(), ref.end());
+        ref.resize(299000);
+
+        bool thrown = false;
+        try { Vector v(path, 8); } catch( const std::runtime_error& ) { thrown = true; }
+        QVERIFY(thrown);
+        thrown = false;
+        try { binary_max_heap::mapped_vector<int32_t> v(path, 7); } catch( const std::runtime_error& ) { thrown = true; }
+        QVERIFY(thrown);
+
+        {
+            Heap h(Vector(path, 7), binary_max_heap::assume_heap);
+            QVERIFY(h.size() == 299000 && isBinaryHeap(h));
+
+            // still open, so not clean
+            thrown = false;
+            try { Vector v(path, 7, false); } catch( const std::runtime_error& ) { thrown = true; }
+            QVERIFY(thrown);
+
+            for( int i = 0; i < 99000; ++i ) {
+                QVERIFY(h.pop_top() == ref.back());
+                ref.pop_back();
+            }
+        }
+
+        std::FILE *f = std::fopen(path.c_str(), "r+b");
+        QVERIFY(f);
+        std::fseek(f, long(Vector::header_size + 5 * sizeof(int64_t)), SEEK_SET);
+        std::fputc(0x55, f);
+        std::fclose(f);
+        thrown = false;
+        try { Vector v(path, 7); } catch( const std::runtime_error& ) { thrown = true; }
+        QVERIFY(thrown);
+        {
+            Vector v(path, 7, false);
+            QVERIFY(v.size() == 200000);
+        }
+
+        // pushing an element of the container itself while growing
+        for( bool file : {true, false} ) {
+            Vector v = file ? Vector(path + ".self") : Vector();
+            v.reserve(1);
+            while( v.size() < v.capacity() )
+                v.push_back(int64_t(v.size()) + 1);
+            const std::size_t n = v.size();
+            v.push_back(v[5]);
+            QVERIFY(v.size() == n + 1 && v.capacity() > n && v.back() == 6 && v[n - 1] == int64_t(n));
+        }
+
+        // without a file
+        Heap anon;
+        for( int64_t i = 0; i < 200000; ++i )
+            anon.push(i % 1000);
+        for( int64_t i = 0; i < 200000; ++i )
+            QVERIFY(anon.pop_top() == 999 - i / 200);
+        QVERIFY(anon.empty());
+    }
+
+    void testCase23()
+    {
+        typedef binary_max_heap::journaled_heap<int64_t> Journaled;
+        typedef binary_max_heap::heap<int64_t> Heap;
+
+        QTemporaryDir dir;
+        QVERIFY(dir.isValid());
+        const std::string path = (dir.path() + "/heap").toStdString();
+        const std::string crash = (dir.path() + "/crash").toStdString();
+
+        binary_max_heap::journal_options options;
+        options.batchSize = 16;
+        options.checkpointOperations = 500;
+
+        Heap ref;
+        {
+            Journaled j(path, options);
+            QVERIFY(j.empty());
+            Lcg rng;
+            for( int i = 0; i < 2000; ++i ) {
+                const uint64_t state = rng();
+                const int64_t v = int64_t((state >> 33) % 10000);
+                switch( (state >> 20) % 5 ) {
+                case 0:
+                    if( ! ref.empty() ) {
+                        QVERIFY(j.pop_top() == ref.top());
+                        ref.pop();
+                        break;
+                    }
+                    // fall through
+                case 1:
+                case 2:
+                    j.push(v);
+                    ref.push(v);
+                    break;
+                case 3:
+                    if( ! ref.empty() ) {
+                        const std::size_t k = std::size_t(v) % ref.size();
+                        j.erase(j.cbegin() + k);
+                        ref.erase(ref.cbegin() + k);
+                    }
+                    break;
+                default:
+                    if( ! ref.empty() ) {
+                        const std::size_t k = std::size_t(v) % ref.size();
+                        j.update(j.cbegin() + k, v);
+                        ref.update(ref.cbegin() + k, v);
+                    }
+                }
+            }
+            QVERIFY(std::equal(j.begin(), j.end(), ref.cbegin()) && j.size() == ref.size());
+
+            // a crash now recovers everything up to the last written batch,
+            // even behind a torn batch
+            j.flush();
+            for( const char *ext : {".ckpt", ".log"} ) {
+                std::ifstream in(path + ext, std::ios::binary);
+                std::ofstream out(crash + ext, std::ios::binary);
+                out << in.rdbuf();
+            }
+            std::ofstream(crash + ".log", std::ios::binary | std::ios::app) << "torn";
+            j.push(-1);
+        }
+        {
+            Journaled j(crash, options);
+            QVERIFY(j.size() == ref.size() && std::equal(j.begin(), j.end(), ref.cbegin()));
+        }
+        ref.push(-1);
+        {
+            Journaled j(path, options);
+            QVERIFY(j.size() == ref.size() && std::equal(j.begin(), j.end(), ref.cbegin()));
+            j.checkpoint();
+            j.pop();
+            ref.pop();
+        }
+        Journaled j(path, options);
+        QVERIFY(j.size() == ref.size() && std::equal(j.begin(), j.end(), ref.cbegin()));
+    }
+
+    void testCase24()
+    {
+        typedef binary_max_heap::segmented_vector<int, 8> Vector;
+
+        // growth keeps elements in place, popping frees blocks with hysteresis
+        Vector v;
+        for( int i = 0; i < 32; ++i )
+            v.push_back(i);
+        const int *first = &v.front();
+        for( int i = 32; i < 100; ++i )
+            v.push_back(i);
+        QVERIFY(&v.front() == first && v.capacity() == 104);
+        QVERIFY(v.at(77) == 77 && *(v.cbegin() + 50) == 50 && v.cend() - v.cbegin() == 100);
+        while( v.size() > 96 )
+            v.pop_back();
+        QVERIFY(v.capacity() == 104);
+        while( v.size() > 88 )
+            v.pop_back();
+        QVERIFY(v.capacity() == 96);
+        v.push_back(88);
+        QVERIFY(v.capacity() == 96 && v.back() == 88);
+        v.set_spare_blocks(0);
+        v.shrink_to_fit();
+        QVERIFY(v.capacity() == 96);
+        const Vector copy = v;
+        QVERIFY(copy == v && copy.size() == 89);
+
+        binary_max_heap::segmented_heap<int, std::less<int>, binary_max_heap::position_tracker_nop, 2, 8> h;
+        binary_max_heap::segmented_heap<int, std::greater<int>, binary_max_heap::position_tracker_nop, 4, 8> g;
+        std::priority_queue<int> ref;
+        Lcg rng;
+        for( int i = 0; i < 5000; ++i ) {
+            const uint64_t state = rng();
+            const int value = int((state >> 33) % 1000);
+            if( (state >> 20) % 3 == 0 && ! ref.empty() ) {
+                QVERIFY(h.pop_top() == ref.top());
+                ref.pop();
+                g.pop();
+            } else {
+                h.push(value);
+                g.push(value);
+                ref.push(value);
+            }
+        }
+        QVERIFY(isBinaryHeap(h) && isBinaryHeap(g) && h.size() == ref.size());
+
+        binary_max_heap::segmented_heap<int, std::less<int>, binary_max_heap::position_tracker_nop, 2, 8>
+                built(Vector{5, 3, 8, 1, 9, 2, 7, 6, 4, 10, 11});
+        QVERIFY(isBinaryHeap(built) && built.top() == 11);
+    }
+
+    void testCase25()
+    {
+        typedef binary_max_heap::small_vector<std::string, 4> Vector;
+
+        // spills past N and returns inline on shrink_to_fit
+        Vector v{"a", "b", "c"};
+        QVERIFY(! v.is_spilled() && v.capacity() == 4);
+        Vector moved(std::move(v));
+        QVERIFY(v.empty() && moved.size() == 3 && moved[2] == "c");
+        for( int i = 0; i < 10; ++i )
+            moved.push_back(std::string(20, char('d' + i)));
+        QVERIFY(moved.is_spilled() && moved.size() == 13 && moved.back() == std::string(20, 'm'));
+        const std::string *spilled = &moved.front();
+        Vector stolen(std::move(moved));
+        QVERIFY(&stolen.front() == spilled && ! moved.is_spilled() && moved.empty());
+        Vector copy = stolen;
+        QVERIFY(copy == stolen && copy.is_spilled());
+        while( copy.size() > 4 )
+            copy.pop_back();
+        copy.shrink_to_fit();
+        QVERIFY(! copy.is_spilled() && copy.size() == 4 && copy[3] == std::string(20, 'd'));
+        v = copy;
+        QVERIFY(v == copy);
+
+        // pushing an element of the container itself while it spills
+        Vector self{"a", "b", "c", std::string(20, 'd')};
+        self.push_back(self[3]);
+        QVERIFY(self.is_spilled() && self.size() == 5 && self[4] == std::string(20, 'd'));
+
+        // a copy failing while spilling leaves the container unchanged
+        binary_max_heap::small_vector<ThrowingCopy, 2> t{"a long string, not stored inline", "b"};
+        for( int throwIn : {1, 2, 3} ) {
+            s_copyThrowIn = throwIn;
+            bool thrown = false;
+            try { t.push_back(t[0]); } catch( const std::runtime_error& ) { thrown = true; }
+            QVERIFY(thrown && s_copyThrowIn == 0);
+            QVERIFY(! t.is_spilled() && t.size() == 2 && t[1].s == "b");
+        }
+        t.push_back(t[0]);
+        QVERIFY(t.is_spilled() && t.size() == 3 && t[2].s == t[0].s);
+        t.pop_back();
+        s_copyThrowIn = 2;
+        bool shrinkThrown = false;
+        try { t.shrink_to_fit(); } catch( const std::runtime_error& ) { shrinkThrown = true; }
+        QVERIFY(shrinkThrown && t.is_spilled() && t.size() == 2 && t[1].s == "b");
+        s_copyThrowIn = 0;
+
+        binary_max_heap::small_heap<int, 8> h;
+        binary_max_heap::small_heap<int, 8, std::greater<int>, binary_max_heap::position_tracker_nop, 4> g;
+        binary_max_heap::static_heap<int, 64> s;
+        std::priority_queue<int> ref;
+        Lcg rng;
+        for( int i = 0; i < 2000; ++i ) {
+            const uint64_t state = rng();
+            const int value = int((state >> 33) % 1000);
+            if( (state >> 20) % 2 == 0 && ! ref.empty() ) {
+                QVERIFY(h.pop_top() == ref.top());
+                QVERIFY(s.pop_top() == ref.top());
+                ref.pop();
+                g.pop();
+            } else if( ref.size() < 64 ) {
+                h.push(value);
+                g.push(value);
+                s.push(value);
+                ref.push(value);
+            }
+        }
+        QVERIFY(isBinaryHeap(h) && isBinaryHeap(g) && isBinaryHeap(s) && h.size() == ref.size());
+
+        // the fixed capacity mode refuses to grow
+        while( s.size() < 64 )
+            s.push(0);
+        bool thrown = false;
+        try { s.push(1); } catch( const std::length_error& ) { thrown = true; }
+        QVERIFY(thrown && s.size() == 64 && s.capacity() == 64 && isBinaryHeap(s));
+    }
+
+private:
+    template< class Heap >
+    void testBuffered()
+    {
+        typedef typename Heap::value_type T;
+        Heap h;
+        std::priority_queue<T, std::vector<T>, decltype(h.compare())> ref;
+        Lcg rng;
+        for( int i = 0; i < 5000; ++i ) {
+            const uint64_t state = rng();
+            const T v = T((state >> 33) % 1000);
+            h.push(v);
+            ref.push(v);
+            if( (state >> 20) % 3 == 0 ) {
+                QVERIFY(h.top() == ref.top());
+                QVERIFY(h.pop_top() == ref.top());
+                ref.pop();
+            }
+            if( i % 1000 == 999 )
+                h.flush();
+            QVERIFY(h.size() == ref.size());
+        }
+        while( ! ref.empty() ) {
+            QVERIFY(h.top() == ref.top());
+            h.pop();
+            ref.pop();
+        }
+        QVERIFY(h.empty());
+    }
+
+    template< class Heap >
+    void testParallelBuild()
+    {
+        for( int n : {0, 1, 1000, 300000} ) {
+            typename Heap::container_type c;
+            for( int i = 0; i < n; ++i )
+                c.push_back(int((i * 7919ll) % 300007));
+
+            std::vector<int> expected(c.begin(), c.end());
+            std::sort(expected.begin(), expected.end());
+
+            for( unsigned threads : {1u, 3u, 8u} ) {
+                Heap h(c, binary_max_heap::build_threads(threads));
+                QVERIFY(isBinaryHeap(h));
+
+                std::vector<int> actual(h.cbegin(), h.cend());
+                std::sort(actual.begin(), actual.end());
+                QVERIFY(actual == expected);
+            }
+        }
+    }
+
+    template< typename T, class Compare, std::size_t Arity >
+    void testArithmetic()
+    {
+        binary_max_heap::heap<T, Compare, binary_max_heap::position_tracker_nop, std::allocator<T>, Arity> h;
+        std::vector<T> values;
+
+        for( int i = 0; i < 1000; ++i ) {
+            values.push_back(T((i * 7919) % 1009) - T(500));
+            h.push(values.back());
+        }
+        QVERIFY(isBinaryHeap(h));
+
+        for( int i = 0; i < 100; ++i ) {
+            h.update(h.cbegin() + (i * 13) % h.size(), T(i));
+            h.erase(h.cbegin() + (i * 17) % h.size());
+        }
+        QVERIFY(isBinaryHeap(h));
+
+        T last = h.top();
+        while( ! h.empty() ) {
+            QVERIFY(! Compare()(last, h.top()));
+            last = h.top();
+            h.pop();
+        }
+    }
+
+    template< class Layout >
+    void testLayout()
+    {
+        // every node is a child of its parent and parents precede children
+        for( long i = 1; i < 5000; ++i ) {
+            const long parent = Layout::parent_index(i);
+            QVERIFY(parent < i);
+
+            const long first = Layout::first_child_index(parent);
+            const long stride = Layout::child_stride(parent);
+            QVERIFY((i - first) % stride == 0);
+            QVERIFY((i - first) / stride < long(Layout::arity));
+        }
+    }
+
+    template< class Heap >
+    void testOperations()
+    {
+        Heap h;
+
+        for( int i = 0; i < 100; ++i )
+            QVERIFY(checkedPush(h, (i * 37) % 101));
+
+        const auto first = h.cbegin();
+        for( int i = 0; i < 20; ++i ) {
+            h.update(first + (i * 13) % h.size(), (i * 59) % 103);
+            QVERIFY(isBinaryHeap(h));
+            h.decrease(first, *first - 50);
+            QVERIFY(isBinaryHeap(h));
+            h.erase(first + (i * 7) % h.size());
+            QVERIFY(isBinaryHeap(h));
+        }
+
+        for( int i = 0; i < 20; ++i ) {
+            const auto pos = first + (i * 11) % h.size();
+            h.decrease(pos, *pos - (i % 3) * 10);
+            QVERIFY(isBinaryHeap(h));
+        }
+
+        while( ! h.empty() )
+            QVERIFY(checkedPop(h));
+
+        typename Heap::container_type v;
+        for( int i = 0; i < 77; ++i )
+            v.push_back((i * 31) % 50);
+        Heap h2(std::move(v));
+        QVERIFY(isBinaryHeap(h2));
+
+        // push_range, sifting up few and rebuilding for many new elements
+        for( int k : {3, 40, 1000, 1} ) {
+            std::vector<int> values;
+            for( int i = 0; i < k; ++i )
+                values.push_back((i * 17) % 97);
+
+            std::vector<int> expected(h2.cbegin(), h2.cend());
+            expected.insert(expected.end(), values.begin(), values.end());
+            std::sort(expected.begin(), expected.end());
+
+            h2.push_range(values.begin(), values.end());
+            QVERIFY(isBinaryHeap(h2));
+
+            std::vector<int> actual(h2.cbegin(), h2.cend());
+            std::sort(actual.begin(), actual.end());
+            QVERIFY(actual == expected);
+        }
+
+        Heap h3;
+        h3.push_range(h2.cbegin(), h2.cend());
+        QVERIFY(isBinaryHeap(h3) && h3.size() == h2.size());
+
+        // merge, taking over the storage of the larger heap or inserting
+        Heap h4;
+        for( int i = 0; i < 10; ++i )
+            h4.push((i * 7) % 13);
+
+        std::vector<int> expected(h3.cbegin(), h3.cend());
+        expected.insert(expected.end(), h4.cbegin(), h4.cend());
+        expected.insert(expected.end(), h2.cbegin(), h2.cend());
+        expected.insert(expected.end(), expected.begin(), expected.end());
+        std::sort(expected.begin(), expected.end());
+
+        h4.merge(std::move(h3));
+        QVERIFY(isBinaryHeap(h4) && h3.empty());
+        h4.merge(static_cast<const Heap&>(h2));
+        QVERIFY(isBinaryHeap(h4) && ! h2.empty());
+        h4.merge(static_cast<const Heap&>(h4));
+        QVERIFY(isBinaryHeap(h4));
+
+        std::vector<int> actual(h4.cbegin(), h4.cend());
+        std::sort(actual.begin(), actual.end());
+        QVERIFY(actual == expected);
+
+        h3.merge(std::move(h4));
+        QVERIFY(isBinaryHeap(h3) && h4.empty() && h3.size() == expected.size());
+
+        // erase_if
+        for( int m : {97, 13, 2, 1} ) {
+            std::vector<int> kept;
+            std::copy_if(h3.cbegin(), h3.cend(), std::back_inserter(kept), [m] (int v) { return v % m != 1; });
+            std::sort(kept.begin(), kept.end());
+
+            const auto removed = h3.erase_if([m] (int v) { return v % m == 1; });
+            QVERIFY(isBinaryHeap(h3) && h3.size() == kept.size());
+            QVERIFY(removed == expected.size() - kept.size());
+
+            std::vector<int> actual(h3.cbegin(), h3.cend());
+            std::sort(actual.begin(), actual.end());
+            QVERIFY(actual == kept);
+            expected = kept;
+        }
+        QVERIFY(h3.erase_if([] (int) { return true; }) == expected.size() && h3.empty());
+
+        // update_batch, repairing few or many changed elements
+        for( int count : {1, 3, 10, 500} ) {
+            Heap h5;
+            for( int i = 0; i < 300; ++i )
+                h5.push((i * 37) % 301);
+
+            std::vector<int> values(h5.cbegin(), h5.cend());
+            {
+                typename Heap::update_batch batch(h5);
+                for( int i = 0; i < count; ++i ) {
+                    const int p = (i * 53) % 300;
+                    values[p] = (i * 71) % 601 - 150;
+                    batch.update(h5.cbegin() + p, values[p]);
+                }
+                if( count == 10 ) {
+                    QVERIFY(batch.top() == *std::max_element(values.begin(), values.end()));
+                    QVERIFY(isBinaryHeap(h5));
+                }
+            }
+            QVERIFY(isBinaryHeap(h5));
+
+            std::vector<int> actual(h5.cbegin(), h5.cend());
+            std::sort(actual.begin(), actual.end());
+            std::sort(values.begin(), values.end());
+            QVERIFY(actual == values);
+        }
+    }
 };
 
 